@@ -0,0 +1,203 @@
+/*
+File: include/matrix/dense/block_kernels.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../../util/parallel.hpp"
+#include "dense.hpp"
+#include "reductions.hpp"
+
+namespace Zee {
+
+// Kernels that combine a block of vectors \f$V = [v_0, ..., v_{k - 1}]\f$
+// with a single vector, or with a second block, as used in (block)
+// Gram-Schmidt orthogonalization. They work on tiles of
+// `reduction::chunk_size` elements, such that a tile of the other vectors is
+// read from memory once for the entire block.
+
+namespace detail {
+
+/** Computes h = V^T w for the k columns of V in one pass over w. The chunks
+ * are the same as for `reduction::sum`, so h[j] is identical to the dot
+ * product of column j and w. */
+template <typename TVal>
+void multiDot(std::size_t n, const TVal* const* columns, std::size_t k,
+              const TVal* w, TVal* h) {
+    if (k == 0) return;
+
+    auto chunks = std::max((n + reduction::chunk_size - 1) /
+                               reduction::chunk_size,
+                           (std::size_t)1);
+
+    // one partial sum per chunk and column
+    std::vector<TVal> partialSums(chunks * k);
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto chunk = first; chunk < last; ++chunk) {
+            auto begin = chunk * reduction::chunk_size;
+            auto end = std::min(n, begin + reduction::chunk_size);
+            for (std::size_t j = 0; j < k; ++j) {
+                const auto* v = columns[j];
+                partialSums[chunk * k + j] = reduction::pairwiseSum<TVal>(
+                    begin, end, [v, w](std::size_t i) { return v[i] * w[i]; });
+            }
+        }
+    });
+
+    // a single reduction for all coefficients
+    for (std::size_t j = 0; j < k; ++j) {
+        h[j] = reduction::pairwiseSum<TVal>(
+            0, chunks,
+            [&](std::size_t chunk) { return partialSums[chunk * k + j]; });
+    }
+}
+
+/** Computes w = beta w + alpha V h for the k columns of V in one pass over
+ * w */
+template <typename TVal>
+void multiAxpy(std::size_t n, TVal alpha, const TVal* const* columns,
+               std::size_t k, const TVal* h, TVal* w, TVal beta = 1) {
+    if (k == 0 && beta == 1) return;
+
+    auto chunks = (n + reduction::chunk_size - 1) / reduction::chunk_size;
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto chunk = first; chunk < last; ++chunk) {
+            auto begin = chunk * reduction::chunk_size;
+            auto end = std::min(n, begin + reduction::chunk_size);
+            if (beta != 1) {
+                for (auto i = begin; i < end; ++i) {
+                    w[i] *= beta;
+                }
+            }
+            for (std::size_t j = 0; j < k; ++j) {
+                const auto* v = columns[j];
+                auto coefficient = alpha * h[j];
+                for (auto i = begin; i < end; ++i) {
+                    w[i] += coefficient * v[i];
+                }
+            }
+        }
+    });
+}
+
+/** Computes H = V^T W for the k columns of V and the b columns of W, in one
+ * pass over W and with a single reduction for all coefficients. H is stored
+ * by columns, so that column c of H, starting at H + c k, is identical to the
+ * result of `multiDot` for column c of W. */
+template <typename TVal>
+void blockDot(std::size_t n, const TVal* const* columns, std::size_t k,
+              const TVal* const* block, std::size_t b, TVal* H) {
+    if (k == 0 || b == 0) return;
+
+    auto chunks = std::max((n + reduction::chunk_size - 1) /
+                               reduction::chunk_size,
+                           (std::size_t)1);
+
+    // one partial sum per chunk and coefficient
+    auto size = k * b;
+    std::vector<TVal> partialSums(chunks * size);
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto chunk = first; chunk < last; ++chunk) {
+            auto begin = chunk * reduction::chunk_size;
+            auto end = std::min(n, begin + reduction::chunk_size);
+            for (std::size_t c = 0; c < b; ++c) {
+                const auto* w = block[c];
+                for (std::size_t j = 0; j < k; ++j) {
+                    const auto* v = columns[j];
+                    partialSums[chunk * size + c * k + j] =
+                        reduction::pairwiseSum<TVal>(
+                            begin, end,
+                            [v, w](std::size_t i) { return v[i] * w[i]; });
+                }
+            }
+        }
+    });
+
+    for (std::size_t l = 0; l < size; ++l) {
+        H[l] = reduction::pairwiseSum<TVal>(
+            0, chunks,
+            [&](std::size_t chunk) { return partialSums[chunk * size + l]; });
+    }
+}
+
+/** Computes W = W + alpha V H for the k columns of V and the b columns of W,
+ * with H stored by columns as computed by `blockDot`, in one pass over W */
+template <typename TVal>
+void blockAxpy(std::size_t n, TVal alpha, const TVal* const* columns,
+               std::size_t k, const TVal* H, TVal* const* block,
+               std::size_t b) {
+    if (k == 0 || b == 0) return;
+
+    auto chunks = (n + reduction::chunk_size - 1) / reduction::chunk_size;
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto chunk = first; chunk < last; ++chunk) {
+            auto begin = chunk * reduction::chunk_size;
+            auto end = std::min(n, begin + reduction::chunk_size);
+            for (std::size_t c = 0; c < b; ++c) {
+                auto* w = block[c];
+                for (std::size_t j = 0; j < k; ++j) {
+                    const auto* v = columns[j];
+                    auto coefficient = alpha * H[c * k + j];
+                    for (auto i = begin; i < end; ++i) {
+                        w[i] += coefficient * v[i];
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename TVal, typename TIdx>
+std::vector<const TVal*> columnPointers(
+    const std::vector<DVector<TVal, TIdx>>& V, TIdx k) {
+    JWAssert(k <= V.size());
+    std::vector<const TVal*> columns(k);
+    for (TIdx j = 0; j < k; ++j) {
+        columns[j] = V[j].data();
+    }
+    return columns;
+}
+
+}  // namespace detail
+
+/** Computes the k inner products \f$h_j = \langle v_j, w \rangle\f$ for the
+ * first k vectors of V, with a single pass over w and a single reduction.
+ * The coefficients are stored in the first k elements of h. */
+template <typename TVal, typename TIdx>
+void multiDot(const std::vector<DVector<TVal, TIdx>>& V, TIdx k,
+              const DVector<TVal, TIdx>& w, DVector<TVal, TIdx>& h) {
+    JWAssert(h.size() >= k);
+    for (TIdx j = 0; j < k; ++j) JWAssert(V[j].size() == w.size());
+
+    auto columns = detail::columnPointers(V, k);
+    detail::multiDot<TVal>(w.size(), columns.data(), k, w.data(), h.data());
+}
+
+/** Computes \f$w = w + \alpha \sum_j h_j v_j\f$ for the first k vectors of V,
+ * with a single pass over w. Use \f$\alpha = -1\f$ to subtract the
+ * projections computed by `multiDot`. */
+template <typename TVal, typename TIdx>
+void multiAxpy(TVal alpha, const std::vector<DVector<TVal, TIdx>>& V, TIdx k,
+               const DVector<TVal, TIdx>& h, DVector<TVal, TIdx>& w) {
+    JWAssert(h.size() >= k);
+    for (TIdx j = 0; j < k; ++j) JWAssert(V[j].size() == w.size());
+
+    auto columns = detail::columnPointers(V, k);
+    detail::multiAxpy<TVal>(w.size(), alpha, columns.data(), k, h.data(),
+                            w.data());
+}
+
+}  // namespace Zee
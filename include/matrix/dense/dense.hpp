@@ -16,6 +16,7 @@ License, or (at your option) any later version.
 #include <cstdint>
 #include <ostream>
 
+#include <algorithm>
 #include <atomic>
 #include <map>
 #include <memory>
@@ -28,6 +29,8 @@ License, or (at your option) any later version.
 #include "../../util/default_types.hpp"
 #include "../base/base.hpp"
 #include "../sparse/sparse.hpp"
+#include "reductions.hpp"
+#include "vector_pool.hpp"
 
 namespace Zee {
 
@@ -56,25 +59,51 @@ class DVector : public DVectorBase<DVector<TVal, TIdx>, TVal, TIdx> {
     using value_type = TVal;
     using index_type = TIdx;
 
-    DVector(TIdx n, TVal defaultValue = 0) : Base(n) {
-        elements_.resize(n);
-        owners_.resize(n);
+    DVector(TIdx n, TVal defaultValue = 0)
+        : Base(n), elements_(VectorPool<TVal>::global().acquire(n)) {
         std::fill(elements_.begin(), elements_.end(), defaultValue);
-        std::fill(owners_.begin(), owners_.end(), (TIdx)0);
     }
 
-    DVector(const DVector& other) : Base(other.size()) {
-        elements_ = other.elements_;
+    DVector(const DVector& other)
+        : Base(other.size()),
+          elements_(VectorPool<TVal>::global().acquire(other.size())) {
+        std::copy(other.elements_.begin(), other.elements_.end(),
+                  elements_.begin());
     }
 
     DVector(DVector&& other) : Base(other.size()) {
         elements_ = std::move(other.elements_);
     }
 
+    /** The storage of a vector is returned to the vector pool */
+    ~DVector() { VectorPool<TVal>::global().release(std::move(elements_)); }
+
+    /** Construct a vector of size n with unspecified elements. This is used
+     * for temporaries that are completely overwritten. */
+    static DVector uninitialized(TIdx n) {
+        return DVector(n, VectorPool<TVal>::global().acquire(n));
+    }
+
     using Base::operator=;
+    using Base::operator+=;
+    using Base::operator-=;
+
+    /** Computes y += a * x in place, see `axpby` */
+    void operator+=(const BinaryOperation<operation::type::scalar_product,
+                                          DVector, TVal>& op) {
+        axpby(op.getRHS(), op.getLHS(), (TVal)1, *this);
+    }
+
+    /** Computes y -= a * x in place, see `axpby` */
+    void operator-=(const BinaryOperation<operation::type::scalar_product,
+                                          DVector, TVal>& op) {
+        axpby(-op.getRHS(), op.getLHS(), (TVal)1, *this);
+    }
 
     void operator=(DVector&& other) {
+        if (this == &other) return;
         this->rows_ = other.size();
+        VectorPool<TVal>::global().release(std::move(elements_));
         elements_ = std::move(other.elements_);
     }
 
@@ -85,28 +114,27 @@ class DVector : public DVectorBase<DVector<TVal, TIdx>, TVal, TIdx> {
 
     const TVal& operator[](TIdx i) const { return elements_[i]; }
 
-    /** The dot product */
-    // FIXME parallellize
+    /** @return a pointer to the (contiguous) elements */
+    TVal* data() { return elements_.data(); }
+    const TVal* data() const { return elements_.data(); }
+
+    /** The dot product. The terms are summed pairwise over fixed chunks that
+     * are processed in parallel, such that the result does not depend on the
+     * number of threads. */
     TVal dot(const DVector<TVal, TIdx>& rhs) const {
         JWAssert(rhs.size() == size());
 
-        const auto& lhs = *this;
-
-        TVal sum = 0;
-        for (TIdx i = 0; i < this->size(); ++i) {
-            sum += lhs[i] * rhs[i];
-        }
-
-        return sum;
+        const auto* x = elements_.data();
+        const auto* y = rhs.elements_.data();
+        return reduction::sum<TVal>(
+            size(), [x, y](std::size_t i) { return x[i] * y[i]; });
     }
 
-    /** The (Euclidian) vector norm */
+    /** The (Euclidian) vector norm, see also `dot` */
     TVal norm() const {
-        TVal sum = 0;
-        for (auto& element : elements_) {
-            sum += element * element;
-        }
-        return sqrt(sum);
+        const auto* x = elements_.data();
+        return sqrt(reduction::sum<TVal>(
+            size(), [x](std::size_t i) { return x[i] * x[i]; }));
     }
 
     void reset() {
@@ -116,10 +144,16 @@ class DVector : public DVectorBase<DVector<TVal, TIdx>, TVal, TIdx> {
     }
 
     void reassign(TIdx element, TIdx processorTarget) override {
+        ensureOwners_();
         owners_[element] = processorTarget;
     }
 
-    const std::vector<TIdx>& getOwners() const { return owners_; }
+    /** @return the owners of the elements, by default everything is owned by
+     * the first processor */
+    const std::vector<TIdx>& getOwners() const {
+        ensureOwners_();
+        return owners_;
+    }
 
     bool operator==(const DVector<TVal, TIdx>& rhs) const {
         auto& lhs = (*this);
@@ -131,8 +165,16 @@ class DVector : public DVectorBase<DVector<TVal, TIdx>, TVal, TIdx> {
     }
 
    private:
+    DVector(TIdx n, std::vector<TVal>&& elements)
+        : Base(n), elements_(std::move(elements)) {}
+
+    // owners are only stored once they are needed
+    void ensureOwners_() const {
+        if (owners_.size() != size()) owners_.resize(size(), 0);
+    }
+
     std::vector<TVal> elements_;
-    std::vector<TIdx> owners_;
+    mutable std::vector<TIdx> owners_;
 };
 
 // We add an operator such that we can log vectors
@@ -327,3 +369,6 @@ std::ostream& operator<<(std::ostream& lhs, const DVector<TVal, TIdx>& rhs) {
 #include "dense_operations.hpp"
 
 }  // namespace Zee
+
+// The kernels that back the vector operations
+#include "vector_kernels.hpp"
@@ -20,7 +20,8 @@ DVector<TVal, TIdx> perform_operation(
 
     const auto& A = op.getLHS();
     const auto& v = op.getRHS();
-    DVector<TVal, TIdx> u{A.getRows(), 0.0};
+    // every element of u is reset below
+    auto u = DVector<TVal, TIdx>::uninitialized(A.getRows());
     const auto p = A.getProcs();
 
     JWAssert(A.getCols() == v.size());
@@ -58,6 +59,284 @@ DVector<TVal, TIdx> perform_operation(
     return u;
 }
 
+/** Computes \f$u = A v\f$ together with \f$\langle v, u \rangle\f$, in the
+ * same pass over the non-zeros of each image. Every image takes the inner
+ * product of v with its own partial sums, and these contributions are combined
+ * in image order, so the result does not depend on the scheduling of the
+ * images. The partial sums are kept in buffers from the vector pool, so that
+ * repeated products do not allocate. The output u should not alias v.
+ * @return the inner product \f$\langle v, A v \rangle\f$ */
+template <typename TVal, typename TIdx>
+TVal multiplyDot(const DSparseMatrix<TVal, TIdx>& A,
+                 const DVector<TVal, TIdx>& v, DVector<TVal, TIdx>& u) {
+    using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getCols() == v.size());
+    JWAssert(A.getRows() == u.size());
+    JWAssert(&u != &v);
+    JWAssert(A.localizedStorage());
+
+    u.reset();
+
+    auto& pool = VectorPool<TVal>::global();
+    std::mutex writeMutex;
+    auto contributions = pool.acquire(A.getProcs());
+
+    A.compute([&](std::shared_ptr<TImage> submatrixPtr, TIdx s) {
+        auto& localIndicesU = submatrixPtr->getLocalIndicesU();
+        auto localU = pool.acquire(localIndicesU.size());
+        std::fill(localU.begin(), localU.end(), (TVal)0);
+
+        auto& localIndicesV = submatrixPtr->getLocalIndicesV();
+        for (const auto& triplet : *submatrixPtr) {
+            localU[triplet.row()] +=
+                triplet.value() * v[localIndicesV[triplet.col()]];
+        }
+
+        contributions[s] = reduction::pairwiseSum<TVal>(
+            0, localU.size(),
+            [&](std::size_t i) { return v[localIndicesU[i]] * localU[i]; });
+
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            for (std::size_t i = 0; i < localU.size(); ++i) {
+                u[localIndicesU[i]] += localU[i];
+            }
+        }
+
+        pool.release(std::move(localU));
+    });
+
+    auto result = reduction::pairwiseSum<TVal>(
+        0, contributions.size(),
+        [&](std::size_t s) { return contributions[s]; });
+    pool.release(std::move(contributions));
+
+    return result;
+}
+
+namespace detail {
+
+/** Computes \f$u = A v\f$, or \f$u = b - A v\f$ if b is given, together with
+ * the norm of u. Every image computes its partial sums, and groups those of
+ * the rows it does not own by their owner. After a single synchronization,
+ * every image finalizes the components of u that it owns: it adds the partial
+ * sums that the other images computed for its rows, in image order, writes
+ * each component once and adds its square to the contribution of the image.
+ * The contributions are combined in image order, so the norm does not depend
+ * on the scheduling of the images. Every component of u is only written by its
+ * owner, so no lock is needed. Since all images have read v before any
+ * component is written, u may alias v or b. */
+template <typename TVal, typename TIdx>
+TVal fusedMultiply(const DSparseMatrix<TVal, TIdx>& A,
+                   const DVector<TVal, TIdx>& v, DVector<TVal, TIdx>& u,
+                   const DVector<TVal, TIdx>* b) {
+    using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+    JWAssert(A.getCols() == v.size());
+    JWAssert(A.getRows() == u.size());
+    JWAssert(b == nullptr || b->size() == u.size());
+    JWAssert(A.localizedStorage());
+
+    const auto p = A.getProcs();
+
+    // the partial sums of an image, with the positions of the remote rows
+    // sorted by their owner, starting at remoteStart[t] for owner t
+    struct PartialSums {
+        std::vector<TVal> values;
+        const TIdx* indices = nullptr;
+        std::vector<TIdx> remote;
+        std::vector<std::size_t> remoteStart;
+    };
+
+    auto& pool = VectorPool<TVal>::global();
+    Barrier<TIdx> barrier(p);
+    std::vector<PartialSums> partialSums(p);
+    auto contributions = pool.acquire(p);
+
+    A.compute([&](std::shared_ptr<TImage> submatrixPtr, TIdx s) {
+        auto& localIndicesU = submatrixPtr->getLocalIndicesU();
+        auto& localIndicesV = submatrixPtr->getLocalIndicesV();
+        auto numLocalU = submatrixPtr->getNumLocalU();
+        auto& remoteOwners = submatrixPtr->getRemoteOwnersU();
+        JWAssert(remoteOwners.size() == localIndicesU.size() - numLocalU);
+
+        auto& own = partialSums[s];
+        own.values = pool.acquire(localIndicesU.size());
+        std::fill(own.values.begin(), own.values.end(), (TVal)0);
+        own.indices = localIndicesU.data();
+        for (const auto& triplet : *submatrixPtr) {
+            own.values[triplet.row()] +=
+                triplet.value() * v[localIndicesV[triplet.col()]];
+        }
+
+        // a counting sort of the remote rows by owner
+        own.remoteStart.assign(p + 1, 0);
+        for (auto owner : remoteOwners) {
+            own.remoteStart[owner + 1]++;
+        }
+        for (TIdx t = 0; t < p; ++t) {
+            own.remoteStart[t + 1] += own.remoteStart[t];
+        }
+        own.remote.resize(remoteOwners.size());
+        auto next = own.remoteStart;
+        for (std::size_t k = 0; k < remoteOwners.size(); ++k) {
+            own.remote[next[remoteOwners[k]]++] = numLocalU + k;
+        }
+
+        barrier.sync();
+
+        // the owned indices are ascending, so that the partial sums of the
+        // other images are added to their rows by a binary search
+        auto first = localIndicesU.begin();
+        auto last = first + numLocalU;
+        JWAssert(std::is_sorted(first, last));
+        for (TIdx q = 0; q < p; ++q) {
+            if (q == s) continue;
+            auto& other = partialSums[q];
+            for (auto k = other.remoteStart[s]; k < other.remoteStart[s + 1];
+                 ++k) {
+                auto l = other.remote[k];
+                auto it = std::lower_bound(first, last, other.indices[l]);
+                JWAssert(it != last && *it == other.indices[l]);
+                own.values[it - first] += other.values[l];
+            }
+        }
+
+        contributions[s] =
+            reduction::pairwiseSum<TVal>(0, numLocalU, [&](std::size_t l) {
+                auto i = localIndicesU[l];
+                auto value = b ? (*b)[i] - own.values[l] : own.values[l];
+                u[i] = value;
+                return value * value;
+            });
+    });
+
+    auto norm = std::sqrt(reduction::pairwiseSum<TVal>(
+        0, contributions.size(),
+        [&](std::size_t s) { return contributions[s]; }));
+
+    pool.release(std::move(contributions));
+    for (auto& sums : partialSums) {
+        pool.release(std::move(sums.values));
+    }
+
+    return norm;
+}
+
+}  // namespace detail
+
+/** Computes \f$u = A v\f$ together with its norm. Every image sums the
+ * squares of the components of u that it owns while it writes them, so the
+ * norm needs neither a separate pass over u nor a reduction of its own. The
+ * output u may alias v.
+ * @return \f$\| A v \|\f$ */
+template <typename TVal, typename TIdx>
+TVal multiplyNorm(const DSparseMatrix<TVal, TIdx>& A,
+                  const DVector<TVal, TIdx>& v, DVector<TVal, TIdx>& u) {
+    return detail::fusedMultiply(A, v, u,
+                                 (const DVector<TVal, TIdx>*)nullptr);
+}
+
+/** Computes the residual \f$r = b - A x\f$ together with its norm, instead
+ * of an SpMV, a subtraction into a temporary and a separate norm. Every
+ * image writes the components of r that it owns once, and sums their squares
+ * as it does so. The output r may alias x or b.
+ * @return \f$\| b - A x \|\f$ */
+template <typename TVal, typename TIdx>
+TVal residual(const DSparseMatrix<TVal, TIdx>& A,
+              const DVector<TVal, TIdx>& x, const DVector<TVal, TIdx>& b,
+              DVector<TVal, TIdx>& r) {
+    return detail::fusedMultiply(A, x, r, &b);
+}
+
+/** Computes \f$v = A^T u\f$ on the images of A, without forming the
+ * transpose. The roles of the local indices are swapped with respect to
+ * \f$A v\f$: every image reads u through its row indices and accumulates
+ * into v through its column indices, so the distributions of u and v may
+ * differ. The output v should not alias u. */
+template <typename TVal, typename TIdx>
+void multiplyTransposed(const DSparseMatrix<TVal, TIdx>& A,
+                        const DVector<TVal, TIdx>& u, DVector<TVal, TIdx>& v) {
+    using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+    JWAssert(A.getRows() == u.size());
+    JWAssert(A.getCols() == v.size());
+    JWAssert(&u != &v);
+    JWAssert(A.localizedStorage());
+
+    v.reset();
+
+    std::mutex writeMutex;
+
+    A.compute([&](std::shared_ptr<TImage> submatrixPtr, TIdx) {
+        std::vector<TVal> localV(submatrixPtr->getLocalIndicesV().size());
+        auto& localIndicesU = submatrixPtr->getLocalIndicesU();
+        for (const auto& triplet : *submatrixPtr) {
+            localV[triplet.col()] +=
+                triplet.value() * u[localIndicesU[triplet.row()]];
+        }
+
+        auto& localIndicesV = submatrixPtr->getLocalIndicesV();
+        std::lock_guard<std::mutex> lock(writeMutex);
+        for (std::size_t j = 0; j < localV.size(); ++j) {
+            v[localIndicesV[j]] += localV[j];
+        }
+    });
+}
+
+/** Computes the SpMM \f$U = A V\f$ for a block of k = V.size() vectors, with
+ * a single pass over the non-zeros of each image. Every image first gathers
+ * the elements of the block that it needs, interleaved by row, such that each
+ * non-zero is applied to all k vectors at once. The outputs should not alias
+ * the inputs. */
+template <typename TVal, typename TIdx>
+void multiplyBlock(const DSparseMatrix<TVal, TIdx>& A,
+                   const std::vector<DVector<TVal, TIdx>>& V,
+                   std::vector<DVector<TVal, TIdx>>& U) {
+    using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+    auto k = V.size();
+    JWAssert(U.size() == k);
+    JWAssert(A.localizedStorage());
+    for (std::size_t c = 0; c < k; ++c) {
+        JWAssert(A.getCols() == V[c].size());
+        JWAssert(A.getRows() == U[c].size());
+        JWAssert(&U[c] != &V[c]);
+        U[c].reset();
+    }
+
+    std::mutex writeMutex;
+
+    A.compute([&](std::shared_ptr<TImage> submatrixPtr, TIdx) {
+        auto& localIndicesV = submatrixPtr->getLocalIndicesV();
+        std::vector<TVal> localV(localIndicesV.size() * k);
+        for (std::size_t j = 0; j < localIndicesV.size(); ++j) {
+            for (std::size_t c = 0; c < k; ++c) {
+                localV[j * k + c] = V[c][localIndicesV[j]];
+            }
+        }
+
+        auto& localIndicesU = submatrixPtr->getLocalIndicesU();
+        std::vector<TVal> localU(localIndicesU.size() * k);
+        for (const auto& triplet : *submatrixPtr) {
+            auto* u = localU.data() + triplet.row() * k;
+            const auto* v = localV.data() + triplet.col() * k;
+            for (std::size_t c = 0; c < k; ++c) {
+                u[c] += triplet.value() * v[c];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(writeMutex);
+        for (std::size_t i = 0; i < localIndicesU.size(); ++i) {
+            for (std::size_t c = 0; c < k; ++c) {
+                U[c][localIndicesU[i]] += localU[i * k + c];
+            }
+        }
+    });
+}
+
 template <typename TVal, typename TIdx>
 DMatrix<TVal, TIdx> perform_operation(
     BinaryOperation<operation::type::product, DMatrix<TVal, TIdx>,
@@ -23,10 +23,8 @@ DVector<TVal, TIdx> perform_operation(
 
     JWAssert(lhs.size() == rhs.size());
 
-    auto returnVector = DVector<TVal, TIdx>(lhs.size());
-    for (TIdx i = 0; i < lhs.size(); ++i) {
-        returnVector[i] = lhs[i] + rhs[i];
-    }
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(lhs.size());
+    waxpby((TVal)1, lhs, (TVal)1, rhs, returnVector);
 
     return returnVector;
 }
@@ -41,10 +39,8 @@ DVector<TVal, TIdx> perform_operation(
 
     JWAssert(lhs.size() == rhs.size());
 
-    auto returnVector = DVector<TVal, TIdx>(lhs.size());
-    for (TIdx i = 0; i < lhs.size(); ++i) {
-        returnVector[i] = lhs[i] - rhs[i];
-    }
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(lhs.size());
+    waxpby((TVal)1, lhs, (TVal)-1, rhs, returnVector);
 
     return returnVector;
 }
@@ -56,10 +52,8 @@ DVector<TVal, TIdx> perform_operation(
     auto& lhs = operation.getLHS();
     auto& rhs = operation.getRHS();
 
-    auto returnVector = DVector<TVal, TIdx>(lhs.size());
-    for (TIdx i = 0; i < lhs.size(); ++i) {
-        returnVector[i] = lhs[i] * rhs;
-    }
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(lhs.size());
+    scale(rhs, lhs, returnVector);
 
     return returnVector;
 }
@@ -71,10 +65,78 @@ DVector<TVal, TIdx> perform_operation(
     auto& lhs = operation.getLHS();
     auto& rhs = operation.getRHS();
 
-    auto returnVector = DVector<TVal, TIdx>(lhs.size());
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(lhs.size());
     for (TIdx i = 0; i < lhs.size(); ++i) {
         returnVector[i] = lhs[i] / rhs;
     }
 
     return returnVector;
 }
+
+// FUSED OPERATIONS ///////////////////////////////////////////////////////////
+// Linear combinations of two vectors are evaluated by a single kernel, without
+// a temporary for the scaled vector(s).
+
+template <typename TVal, typename TIdx>
+using ScaledDVector =
+    BinaryOperation<operation::type::scalar_product, DVector<TVal, TIdx>, TVal>;
+
+// x + a * y
+template <typename TVal, typename TIdx>
+DVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::addition, DVector<TVal, TIdx>,
+                    ScaledDVector<TVal, TIdx>>
+        operation) {
+    auto& x = operation.getLHS();
+    auto& ay = operation.getRHS();
+
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(x.size());
+    waxpby((TVal)1, x, ay.getRHS(), ay.getLHS(), returnVector);
+
+    return returnVector;
+}
+
+// x - a * y
+template <typename TVal, typename TIdx>
+DVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::subtraction, DVector<TVal, TIdx>,
+                    ScaledDVector<TVal, TIdx>>
+        operation) {
+    auto& x = operation.getLHS();
+    auto& ay = operation.getRHS();
+
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(x.size());
+    waxpby((TVal)1, x, -ay.getRHS(), ay.getLHS(), returnVector);
+
+    return returnVector;
+}
+
+// a * x + y
+template <typename TVal, typename TIdx>
+DVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::addition, ScaledDVector<TVal, TIdx>,
+                    DVector<TVal, TIdx>>
+        operation) {
+    auto& ax = operation.getLHS();
+    auto& y = operation.getRHS();
+
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(y.size());
+    waxpby(ax.getRHS(), ax.getLHS(), (TVal)1, y, returnVector);
+
+    return returnVector;
+}
+
+// a * x + b * y
+template <typename TVal, typename TIdx>
+DVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::addition, ScaledDVector<TVal, TIdx>,
+                    ScaledDVector<TVal, TIdx>>
+        operation) {
+    auto& ax = operation.getLHS();
+    auto& by = operation.getRHS();
+
+    auto returnVector = DVector<TVal, TIdx>::uninitialized(ax.getLHS().size());
+    waxpby(ax.getRHS(), ax.getLHS(), by.getRHS(), by.getLHS(), returnVector);
+
+    return returnVector;
+}
@@ -0,0 +1,529 @@
+/*
+File: include/matrix/dense/partitioned_vector.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../../util/common.hpp"
+#include "dense.hpp"
+#include "reductions.hpp"
+
+namespace Zee {
+
+/** Which vector of a SpMV \f$u = A v\f$ a partitioned vector is laid out
+ * for. A `column` vector is laid out as \f$v\f$, and a `row` vector as
+ * \f$u\f$. */
+enum class vector_space { column, row };
+
+/** The (shared) index layout of one image of a partitioned vector */
+template <typename TIdx>
+struct DVectorLayout {
+    /** A ghost element on another image that corresponds to one of our owned
+     * elements */
+    struct GhostLink {
+        TIdx image;
+        TIdx index;
+        TIdx target;
+    };
+
+    /** Maps local indices to global indices. The owned indices come first and
+     * are ascending, followed by the ghost indices. This is the same order as
+     * the local indices of a localized matrix image. */
+    std::vector<TIdx> localIndices;
+    /** The number of owned elements */
+    TIdx numLocal = 0;
+    /** For each ghost element, the image that owns it */
+    std::vector<TIdx> ghostOwners;
+    /** For each ghost element, its local index on the owning image */
+    std::vector<TIdx> ghostSources;
+    /** The ghost elements on other images of our owned elements */
+    std::vector<GhostLink> incoming;
+};
+
+/** The part of a partitioned vector that is stored by a single image. It holds
+ * only the owned elements, and ghost copies of the remote elements that the
+ * image needs. */
+template <typename TVal, typename TIdx>
+class DVectorImage {
+   public:
+    DVectorImage(std::shared_ptr<const DVectorLayout<TIdx>> layout,
+                  TVal defaultValue = 0)
+        : layout_(layout),
+          elements_(layout->localIndices.size(), defaultValue) {}
+
+    /** @return the element with the given local index */
+    TVal& operator[](TIdx localIndex) { return elements_[localIndex]; }
+    const TVal& operator[](TIdx localIndex) const {
+        return elements_[localIndex];
+    }
+
+    /** @return the number of stored elements, including ghosts */
+    TIdx size() const { return elements_.size(); }
+
+    /** @return the number of owned elements */
+    TIdx getNumLocal() const { return layout_->numLocal; }
+
+    /** @return the global indices of the stored elements */
+    const std::vector<TIdx>& getLocalIndices() const {
+        return layout_->localIndices;
+    }
+
+    const DVectorLayout<TIdx>& getLayout() const { return *layout_; }
+
+    const std::shared_ptr<const DVectorLayout<TIdx>>& getSharedLayout() const {
+        return layout_;
+    }
+
+    TVal* data() { return elements_.data(); }
+    const TVal* data() const { return elements_.data(); }
+
+   private:
+    std::shared_ptr<const DVectorLayout<TIdx>> layout_;
+    std::vector<TVal> elements_;
+};
+
+/** A vector that is physically distributed over images. Every image stores its
+ * owned elements, in the local index order computed by
+ * `VectorPartitioner::localizeMatrix`, followed by the ghost elements it needs
+ * for a SpMV. Accessing elements by their global index is supported, but is
+ * a slow path. */
+template <typename TVal = default_scalar_type,
+          typename TIdx = default_index_type>
+class DPartitionedVector
+    : public DMatrixBase<DPartitionedVector<TVal, TIdx>, TVal, TIdx> {
+    using Base = DMatrixBase<DPartitionedVector<TVal, TIdx>, TVal, TIdx>;
+
+   public:
+    using value_type = TVal;
+    using index_type = TIdx;
+    using image_type = DVectorImage<TVal, TIdx>;
+    using layout_type = DVectorLayout<TIdx>;
+
+    /** Distribute a vector over images according to its owners. The result
+     * does not have ghost elements. */
+    explicit DPartitionedVector(const DVector<TVal, TIdx>& v, TIdx procs = 0)
+        : Base(v.size(), 1) {
+        const auto& owners = v.getOwners();
+        for (auto owner : owners) {
+            procs = std::max(procs, (TIdx)(owner + 1));
+        }
+        procs = std::max(procs, (TIdx)1);
+        this->setProcs(procs);
+
+        std::vector<std::shared_ptr<layout_type>> layouts(procs);
+        for (auto& layout : layouts) {
+            layout = std::make_shared<layout_type>();
+        }
+
+        for (TIdx i = 0; i < v.size(); ++i) {
+            layouts[owners[i]]->localIndices.push_back(i);
+        }
+
+        for (auto& layout : layouts) {
+            layout->numLocal = layout->localIndices.size();
+            images_.push_back(std::make_shared<image_type>(layout));
+        }
+
+        scatter(v);
+    }
+
+    /** Construct a vector that is laid out as the columns (or rows) of the
+     * localized matrix, including its ghost elements */
+    template <class TMatrix>
+    DPartitionedVector(const TMatrix& matrix, vector_space space,
+                       TVal defaultValue = 0)
+        : Base(space == vector_space::column ? matrix.getCols()
+                                             : matrix.getRows(),
+               1) {
+        JWAssert(matrix.localizedStorage());
+
+        const auto& matrixImages = matrix.getImages();
+        TIdx p = matrixImages.size();
+        this->setProcs(p);
+
+        std::vector<std::shared_ptr<layout_type>> layouts(p);
+        for (TIdx s = 0; s < p; ++s) {
+            auto& image = *matrixImages[s];
+            layouts[s] = std::make_shared<layout_type>();
+            auto& layout = *layouts[s];
+            if (space == vector_space::column) {
+                layout.localIndices = image.getLocalIndicesV();
+                layout.numLocal = image.getNumLocalV();
+                layout.ghostOwners = image.getRemoteOwnersV();
+            } else {
+                layout.localIndices = image.getLocalIndicesU();
+                layout.numLocal = image.getNumLocalU();
+                layout.ghostOwners = image.getRemoteOwnersU();
+            }
+        }
+
+        // find the ghost elements on their owners
+        for (TIdx s = 0; s < p; ++s) {
+            auto& layout = *layouts[s];
+            layout.ghostSources.resize(layout.ghostOwners.size());
+            for (TIdx k = 0; k < layout.ghostOwners.size(); ++k) {
+                auto owner = layout.ghostOwners[k];
+                auto& ownerLayout = *layouts[owner];
+                auto first = ownerLayout.localIndices.begin();
+                auto last = first + ownerLayout.numLocal;
+                auto it = std::lower_bound(
+                    first, last, layout.localIndices[layout.numLocal + k]);
+                JWAssert(it != last);
+
+                TIdx source = it - first;
+                layout.ghostSources[k] = source;
+                ownerLayout.incoming.push_back(
+                    {s, layout.numLocal + k, source});
+            }
+        }
+
+        for (auto& layout : layouts) {
+            images_.push_back(
+                std::make_shared<image_type>(layout, defaultValue));
+        }
+    }
+
+    DPartitionedVector(const DPartitionedVector& other)
+        : Base(other.size(), 1) {
+        *this = other;
+    }
+
+    DPartitionedVector(DPartitionedVector&& other) : Base(other.size(), 1) {
+        *this = std::move(other);
+    }
+
+    using Base::operator=;
+
+    // images are held by shared pointers, so we copy them explicitely
+    void operator=(const DPartitionedVector& other) {
+        this->rows_ = other.size();
+        this->setProcs(other.getProcs());
+        images_.clear();
+        for (auto& image : other.images_) {
+            images_.push_back(std::make_shared<image_type>(*image));
+        }
+    }
+
+    void operator=(DPartitionedVector&& other) {
+        this->rows_ = other.size();
+        this->setProcs(other.getProcs());
+        images_ = std::move(other.images_);
+    }
+
+    /** Return the size of the vector */
+    TIdx size() const { return this->rows_; }
+
+    /** Obtain a list of images */
+    const std::vector<std::shared_ptr<image_type>>& getImages() const {
+        return images_;
+    }
+
+    image_type& operator[](size_t s) { return *images_[s]; }
+    const image_type& operator[](size_t s) const { return *images_[s]; }
+
+    /** Global access to an element. This has to search for the owner of
+     * element i, and should not be used in performance critical code. */
+    TVal& at(TIdx i) {
+        auto location = locate_(i);
+        return (*images_[location.first])[location.second];
+    }
+
+    const TVal& at(TIdx i) const {
+        auto location = locate_(i);
+        return (*images_[location.first])[location.second];
+    }
+
+    /** Copy the owned (and ghost) elements from a global vector */
+    void scatter(const DVector<TVal, TIdx>& v) {
+        JWAssert(v.size() == size());
+        compute([&](image_type& image, TIdx) {
+            const auto& indices = image.getLocalIndices();
+            for (TIdx l = 0; l < image.size(); ++l) {
+                image[l] = v[indices[l]];
+            }
+        });
+    }
+
+    /** Collect the elements into a (global) vector, with the owners set
+     * accordingly. This requires O(n) memory. */
+    DVector<TVal, TIdx> gather() const {
+        DVector<TVal, TIdx> v(size());
+        TIdx s = 0;
+        for (auto& image : images_) {
+            const auto& indices = image->getLocalIndices();
+            for (TIdx l = 0; l < image->getNumLocal(); ++l) {
+                v[indices[l]] = (*image)[l];
+                v.reassign(indices[l], s);
+            }
+            ++s;
+        }
+        return v;
+    }
+
+    /** Copy the values of the owned elements into the ghost elements on the
+     * other images. The ghost elements are part of the state of the vector, so
+     * this must not run concurrently with other uses of the vector. */
+    void updateGhosts() {
+        compute([&](image_type& image, TIdx) {
+            const auto& layout = image.getLayout();
+            for (TIdx k = 0; k < layout.ghostOwners.size(); ++k) {
+                image[layout.numLocal + k] =
+                    (*images_[layout.ghostOwners[k]])[layout.ghostSources[k]];
+            }
+        });
+    }
+
+    /** Add the (partial) values of the ghost elements to their owned
+     * counterparts. This should be called after all images wrote their ghosts,
+     * e.g. after a barrier. */
+    void accumulateGhosts(TIdx s) {
+        auto& image = *images_[s];
+        for (auto& link : image.getLayout().incoming) {
+            image[link.target] += (*images_[link.image])[link.index];
+        }
+    }
+
+    /** The dot product of the owned elements. The partial sums of the images
+     * are combined in a fixed order. */
+    TVal dot(const DPartitionedVector& rhs) const {
+        JWAssert(rhs.size() == size());
+        JWAssert(rhs.getProcs() == this->getProcs());
+
+        std::vector<TVal> partialSums(images_.size());
+        compute([&](const image_type& image, TIdx s) {
+            const auto* lhsData = image.data();
+            const auto* rhsData = rhs[s].data();
+            JWAssert(rhs[s].getNumLocal() == image.getNumLocal());
+            partialSums[s] = reduction::pairwiseSum<TVal>(
+                0, image.getNumLocal(), [lhsData, rhsData](std::size_t i) {
+                    return lhsData[i] * rhsData[i];
+                });
+        });
+
+        return reduction::pairwiseSum<TVal>(
+            0, partialSums.size(),
+            [&](std::size_t s) { return partialSums[s]; });
+    }
+
+    /** The (Euclidian) vector norm */
+    TVal norm() const { return sqrt(dot(*this)); }
+
+    /** Run func(image, s) for every image, each on its own thread */
+    template <typename TFunc>
+    void compute(TFunc func) {
+        compute_(func, [this](TIdx s) -> image_type& { return *images_[s]; });
+    }
+
+    /** Run func(image, s) for every image, with read-only access to the
+     * images */
+    template <typename TFunc>
+    void compute(TFunc func) const {
+        compute_(func,
+                 [this](TIdx s) -> const image_type& { return *images_[s]; });
+    }
+
+    /** Whether rhs stores the same owned elements on every image */
+    bool compatible(const DPartitionedVector& rhs) const {
+        if (rhs.images_.size() != images_.size()) return false;
+        for (TIdx s = 0; s < images_.size(); ++s) {
+            auto& lhsLayout = images_[s]->getSharedLayout();
+            auto& rhsLayout = rhs.images_[s]->getSharedLayout();
+            if (lhsLayout == rhsLayout) continue;
+            if (lhsLayout->numLocal != rhsLayout->numLocal ||
+                !std::equal(lhsLayout->localIndices.begin(),
+                            lhsLayout->localIndices.begin() +
+                                lhsLayout->numLocal,
+                            rhsLayout->localIndices.begin()))
+                return false;
+        }
+        return true;
+    }
+
+   private:
+    template <typename TFunc, typename TImageOf>
+    void compute_(TFunc& func, TImageOf imageOf) const {
+        if (images_.size() == 1) {
+            func(imageOf(0), 0);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        for (TIdx s = 0; s < images_.size(); ++s) {
+            threads.push_back(
+                std::thread([&func, &imageOf, s]() { func(imageOf(s), s); }));
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    std::pair<TIdx, TIdx> locate_(TIdx i) const {
+        for (TIdx s = 0; s < images_.size(); ++s) {
+            const auto& layout = images_[s]->getLayout();
+            auto first = layout.localIndices.begin();
+            auto last = first + layout.numLocal;
+            auto it = std::lower_bound(first, last, i);
+            if (it != last && *it == i) return make_pair(s, (TIdx)(it - first));
+        }
+
+        JWLogError << "Element " << i << " is not owned by any image"
+                   << endLog;
+        JWAssert(false);
+        return make_pair((TIdx)0, (TIdx)0);
+    }
+
+    std::vector<std::shared_ptr<image_type>> images_;
+};
+
+// OPERATIONS /////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// Apply an element-wise operation to the owned elements of a partitioned
+// vector, the ghost elements of the result are zero
+template <typename TVal, typename TIdx, typename TFunc>
+DPartitionedVector<TVal, TIdx> transformOwned(
+    const DPartitionedVector<TVal, TIdx>& lhs, TFunc func) {
+    auto result = DPartitionedVector<TVal, TIdx>(lhs);
+    result.compute([&](DVectorImage<TVal, TIdx>& image, TIdx s) {
+        auto* out = image.data();
+        for (TIdx l = 0; l < image.getNumLocal(); ++l) {
+            out[l] = func(s, l);
+        }
+        for (TIdx l = image.getNumLocal(); l < image.size(); ++l) {
+            out[l] = 0;
+        }
+    });
+    return result;
+}
+
+}  // namespace detail
+
+template <typename TVal, typename TIdx>
+DPartitionedVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::addition, DPartitionedVector<TVal, TIdx>,
+                    DPartitionedVector<TVal, TIdx>>
+        operation) {
+    auto& lhs = operation.getLHS();
+    auto& rhs = operation.getRHS();
+    JWAssert(lhs.compatible(rhs));
+
+    return detail::transformOwned(
+        lhs, [&](TIdx s, TIdx l) { return lhs[s][l] + rhs[s][l]; });
+}
+
+template <typename TVal, typename TIdx>
+DPartitionedVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::subtraction,
+                    DPartitionedVector<TVal, TIdx>,
+                    DPartitionedVector<TVal, TIdx>>
+        operation) {
+    auto& lhs = operation.getLHS();
+    auto& rhs = operation.getRHS();
+    JWAssert(lhs.compatible(rhs));
+
+    return detail::transformOwned(
+        lhs, [&](TIdx s, TIdx l) { return lhs[s][l] - rhs[s][l]; });
+}
+
+template <typename TVal, typename TIdx>
+DPartitionedVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::scalar_product,
+                    DPartitionedVector<TVal, TIdx>, TVal>
+        operation) {
+    auto& lhs = operation.getLHS();
+    auto alpha = operation.getRHS();
+
+    return detail::transformOwned(
+        lhs, [&](TIdx s, TIdx l) { return lhs[s][l] * alpha; });
+}
+
+template <typename TVal, typename TIdx>
+DPartitionedVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::scalar_division,
+                    DPartitionedVector<TVal, TIdx>, TVal>
+        operation) {
+    auto& lhs = operation.getLHS();
+    auto alpha = operation.getRHS();
+
+    return detail::transformOwned(
+        lhs, [&](TIdx s, TIdx l) { return lhs[s][l] / alpha; });
+}
+
+/** The SpMV u = A v for partitioned vectors. Here v has to be laid out as the
+ * columns of A, and u as its rows. Every image first obtains its ghost
+ * elements of v, then performs a local SpMV, and finally collects the partial
+ * sums of its owned elements of u from the other images. The ghost elements
+ * of v are overwritten, so products that share v must not run concurrently. */
+template <typename TVal, typename TIdx>
+void multiply(const DSparseMatrix<TVal, TIdx>& A,
+              DPartitionedVector<TVal, TIdx>& v,
+              DPartitionedVector<TVal, TIdx>& u) {
+    using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+    JWAssert(A.getCols() == v.size());
+    JWAssert(A.getRows() == u.size());
+    JWAssert(A.localizedStorage());
+    JWAssert(v.getProcs() == A.getProcs());
+    JWAssert(u.getProcs() == A.getProcs());
+    JWAssert(&u != &v);
+
+    Barrier<TIdx> barrier(A.getProcs());
+
+    A.compute([&](std::shared_ptr<TImage> submatrixPtr, TIdx s) {
+        auto& vs = v[s];
+        auto& us = u[s];
+        JWAssert(vs.size() == submatrixPtr->getLocalIndicesV().size());
+        JWAssert(us.size() == submatrixPtr->getLocalIndicesU().size());
+
+        // obtain the ghost elements of v
+        const auto& vLayout = vs.getLayout();
+        auto* vData = vs.data();
+        for (TIdx k = 0; k < vLayout.ghostOwners.size(); ++k) {
+            vData[vLayout.numLocal + k] =
+                v[vLayout.ghostOwners[k]][vLayout.ghostSources[k]];
+        }
+
+        auto* uData = us.data();
+        std::fill(uData, uData + us.size(), (TVal)0);
+        for (const auto& triplet : *submatrixPtr) {
+            uData[triplet.row()] += triplet.value() * vData[triplet.col()];
+        }
+
+        // all partial sums have to be available
+        barrier.sync();
+
+        u.accumulateGhosts(s);
+    });
+}
+
+template <typename TVal, typename TIdx>
+DPartitionedVector<TVal, TIdx> perform_operation(
+    BinaryOperation<operation::type::product, DSparseMatrix<TVal, TIdx>,
+                    DPartitionedVector<TVal, TIdx>>
+        op) {
+    // the expression leaves v untouched, so the ghost elements are exchanged
+    // in a copy, use `multiply` to avoid it
+    const auto& A = op.getLHS();
+    auto v = op.getRHS();
+    DPartitionedVector<TVal, TIdx> u(A, vector_space::row);
+    multiply(A, v, u);
+    return u;
+}
+
+}  // namespace Zee
@@ -0,0 +1,74 @@
+/*
+File: include/matrix/dense/reductions.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../../util/parallel.hpp"
+
+namespace Zee {
+
+namespace reduction {
+
+/** Reductions are split in chunks of this many terms. The chunks are fixed,
+ * independent of the number of threads, which makes the result of a reduction
+ * deterministic. */
+constexpr std::size_t chunk_size = 4096;
+
+/** Below this number of terms pairwise summation uses a plain loop */
+constexpr std::size_t pairwise_base = 32;
+
+/** Pairwise (cascade) summation of term(first), ..., term(last - 1). The
+ * rounding error of pairwise summation grows as O(log n) rather than O(n) for
+ * a naive running sum. */
+template <typename TAcc, typename TTerm>
+TAcc pairwiseSum(std::size_t first, std::size_t last, const TTerm& term) {
+    if (last - first <= pairwise_base) {
+        TAcc sum = 0;
+        for (auto i = first; i < last; ++i) {
+            sum += term(i);
+        }
+        return sum;
+    }
+
+    auto middle = first + (last - first) / 2;
+    return pairwiseSum<TAcc>(first, middle, term) +
+           pairwiseSum<TAcc>(middle, last, term);
+}
+
+/** Computes the sum of term(0), ..., term(n - 1). The chunks are summed in
+ * parallel, and the partial sums are combined pairwise in a fixed order. */
+template <typename TAcc, typename TTerm>
+TAcc sum(std::size_t n, const TTerm& term) {
+    auto chunks = (n + chunk_size - 1) / chunk_size;
+    if (chunks <= 1) return pairwiseSum<TAcc>(0, n, term);
+
+    std::vector<TAcc> partialSums(chunks);
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto chunk = first; chunk < last; ++chunk) {
+            partialSums[chunk] = pairwiseSum<TAcc>(
+                chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size),
+                term);
+        }
+    });
+
+    return pairwiseSum<TAcc>(
+        0, chunks, [&](std::size_t chunk) { return partialSums[chunk]; });
+}
+
+}  // namespace reduction
+
+}  // namespace Zee
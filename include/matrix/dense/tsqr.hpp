@@ -0,0 +1,214 @@
+/*
+File: include/matrix/dense/tsqr.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "../../util/parallel.hpp"
+#include "dense.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** The number of rows of the blocks that are factored independently by TSQR.
+ * This does not depend on the number of threads, so neither does the
+ * result. */
+constexpr std::size_t tsqr_chunk_rows = 4096;
+
+/** Householder QR of a rows x cols matrix a (rows >= cols), stored by
+ * columns. On return the upper triangle of a holds R, and the part below the
+ * diagonal holds the Householder vectors (with an implicit leading one),
+ * whose scaling factors are stored in tau. */
+template <typename TVal>
+void householderQR(std::size_t rows, std::size_t cols, TVal* a, TVal* tau) {
+    JWAssert(rows >= cols);
+
+    for (std::size_t j = 0; j < cols; ++j) {
+        auto* x = a + j * rows;
+
+        TVal norm = 0;
+        for (auto i = j; i < rows; ++i) {
+            norm = std::hypot(norm, x[i]);
+        }
+
+        if (norm == 0) {
+            tau[j] = 0;
+            continue;
+        }
+
+        auto beta = (x[j] >= 0) ? -norm : norm;
+        auto scale = 1 / (x[j] - beta);
+        for (auto i = j + 1; i < rows; ++i) {
+            x[i] *= scale;
+        }
+        tau[j] = (beta - x[j]) / beta;
+        x[j] = beta;
+
+        // apply the reflection to the remaining columns
+        for (auto c = j + 1; c < cols; ++c) {
+            auto* y = a + c * rows;
+            auto w = y[j];
+            for (auto i = j + 1; i < rows; ++i) {
+                w += x[i] * y[i];
+            }
+            w *= tau[j];
+            y[j] -= w;
+            for (auto i = j + 1; i < rows; ++i) {
+                y[i] -= w * x[i];
+            }
+        }
+    }
+}
+
+/** Computes c = Q c for the rows x k matrix c, stored by columns, where Q is
+ * given by the Householder vectors in a and tau as returned by
+ * `householderQR` */
+template <typename TVal>
+void applyHouseholderQ(std::size_t rows, std::size_t cols, const TVal* a,
+                       const TVal* tau, std::size_t k, TVal* c) {
+    for (auto j = cols; j-- > 0;) {
+        if (tau[j] == 0) continue;
+        const auto* x = a + j * rows;
+        for (std::size_t l = 0; l < k; ++l) {
+            auto* y = c + l * rows;
+            auto w = y[j];
+            for (auto i = j + 1; i < rows; ++i) {
+                w += x[i] * y[i];
+            }
+            w *= tau[j];
+            y[j] -= w;
+            for (auto i = j + 1; i < rows; ++i) {
+                y[i] -= w * x[i];
+            }
+        }
+    }
+}
+
+/** Tall-skinny QR of the n x k matrix with the given columns, which are
+ * overwritten by the orthonormal factor Q. The k x k factor R is stored by
+ * columns, and has a non-negative diagonal.
+ *
+ * The rows are split into blocks that are factored independently and in
+ * parallel, after which the stacked triangular factors of the blocks are
+ * factored once more. Every block is read twice in total, and the result is
+ * as stable as Householder QR of the full matrix. */
+template <typename TVal>
+void tsqr(std::size_t n, TVal* const* columns, std::size_t k, TVal* R) {
+    JWAssert(n >= k);
+    if (k == 0) return;
+
+    auto chunkRows = std::max(tsqr_chunk_rows, k);
+    auto chunks = std::max(n / chunkRows, (std::size_t)1);
+    auto begin = [&](std::size_t t) { return (t * n) / chunks; };
+
+    // factor the blocks of rows
+    std::vector<std::vector<TVal>> local(chunks);
+    std::vector<std::vector<TVal>> tau(chunks, std::vector<TVal>(k));
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto t = first; t < last; ++t) {
+            auto rows = begin(t + 1) - begin(t);
+            local[t].resize(rows * k);
+            for (std::size_t j = 0; j < k; ++j) {
+                std::copy(columns[j] + begin(t), columns[j] + begin(t + 1),
+                          local[t].begin() + j * rows);
+            }
+            householderQR(rows, k, local[t].data(), tau[t].data());
+        }
+    });
+
+    // factor the stacked triangular factors
+    auto stackedRows = chunks * k;
+    std::vector<TVal> stacked(stackedRows * k, 0);
+    for (std::size_t t = 0; t < chunks; ++t) {
+        auto rows = begin(t + 1) - begin(t);
+        for (std::size_t j = 0; j < k; ++j) {
+            for (std::size_t i = 0; i <= j; ++i) {
+                stacked[j * stackedRows + t * k + i] = local[t][j * rows + i];
+            }
+        }
+    }
+    std::vector<TVal> stackedTau(k);
+    householderQR(stackedRows, k, stacked.data(), stackedTau.data());
+
+    std::vector<TVal> top(stackedRows * k, 0);
+    for (std::size_t j = 0; j < k; ++j) {
+        top[j * stackedRows + j] = 1;
+    }
+    applyHouseholderQ(stackedRows, k, stacked.data(), stackedTau.data(), k,
+                      top.data());
+
+    // R, with the signs chosen such that its diagonal is non-negative
+    for (std::size_t j = 0; j < k; ++j) {
+        for (std::size_t i = 0; i < k; ++i) {
+            R[j * k + i] = (i <= j) ? stacked[j * stackedRows + i] : 0;
+        }
+    }
+    for (std::size_t i = 0; i < k; ++i) {
+        if (R[i * k + i] >= 0) continue;
+        for (auto j = i; j < k; ++j) {
+            R[j * k + i] = -R[j * k + i];
+        }
+        for (std::size_t t = 0; t < stackedRows; ++t) {
+            top[i * stackedRows + t] = -top[i * stackedRows + t];
+        }
+    }
+
+    // Q is obtained by applying the reflections of the blocks to the
+    // corresponding rows of the orthonormal factor of the stacked matrix
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        for (auto t = first; t < last; ++t) {
+            auto rows = begin(t + 1) - begin(t);
+            std::vector<TVal> q(rows * k, 0);
+            for (std::size_t j = 0; j < k; ++j) {
+                for (std::size_t i = 0; i < k; ++i) {
+                    q[j * rows + i] = top[j * stackedRows + t * k + i];
+                }
+            }
+            applyHouseholderQ(rows, k, local[t].data(), tau[t].data(), k,
+                              q.data());
+            for (std::size_t j = 0; j < k; ++j) {
+                std::copy(q.begin() + j * rows, q.begin() + (j + 1) * rows,
+                          columns[j] + begin(t));
+            }
+        }
+    });
+}
+
+}  // namespace detail
+
+/** Computes the QR factorization of the block of vectors V, using TSQR.
+ * The vectors are overwritten by the orthonormal factor Q, and the
+ * triangular factor R is returned by columns, i.e. \f$R_{ij}\f$ is stored
+ * at index j V.size() + i. */
+template <typename TVal, typename TIdx>
+std::vector<TVal> tsqr(std::vector<DVector<TVal, TIdx>>& V) {
+    auto k = V.size();
+    std::vector<TVal> R(k * k);
+    if (k == 0) return R;
+
+    std::vector<TVal*> columns(k);
+    for (std::size_t j = 0; j < k; ++j) {
+        JWAssert(V[j].size() == V[0].size());
+        columns[j] = V[j].data();
+    }
+    detail::tsqr<TVal>(V[0].size(), columns.data(), k, R.data());
+
+    return R;
+}
+
+}  // namespace Zee
@@ -0,0 +1,130 @@
+/*
+File: include/matrix/dense/vector_kernels.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../../util/parallel.hpp"
+#include "dense.hpp"
+#include "reductions.hpp"
+
+namespace Zee {
+
+// BLAS-1 style vector kernels. The kernels are parallelized over chunks of
+// the vectors, and the loop over a chunk is a unit-stride loop over raw
+// pointers that the compiler vectorizes. Every kernel returns the number of
+// bytes it moved to and from memory, which can be compared with the STREAM
+// bandwidth of the system.
+
+namespace detail {
+
+// Calls func(begin, end) for chunks of [0, n) in parallel
+template <typename TFunc>
+void elementwise(std::size_t n, TFunc func) {
+    auto chunks = (n + reduction::chunk_size - 1) / reduction::chunk_size;
+    parallelChunks(chunks, [&](std::size_t first, std::size_t last) {
+        func(first * reduction::chunk_size,
+             std::min(n, last * reduction::chunk_size));
+    });
+}
+
+}  // namespace detail
+
+/** Computes \f$y = \alpha x + \beta y\f$.
+ * @return the number of bytes moved */
+template <typename TVal, typename TIdx>
+std::size_t axpby(TVal alpha, const DVector<TVal, TIdx>& x, TVal beta,
+                  DVector<TVal, TIdx>& y) {
+    JWAssert(x.size() == y.size());
+
+    const auto* xs = x.data();
+    auto* ys = y.data();
+    detail::elementwise(y.size(), [=](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            ys[i] = alpha * xs[i] + beta * ys[i];
+        }
+    });
+
+    return 3 * sizeof(TVal) * y.size();
+}
+
+/** Computes \f$w = \alpha x + \beta y\f$. The output w may be x or y.
+ * @return the number of bytes moved */
+template <typename TVal, typename TIdx>
+std::size_t waxpby(TVal alpha, const DVector<TVal, TIdx>& x, TVal beta,
+                   const DVector<TVal, TIdx>& y, DVector<TVal, TIdx>& w) {
+    JWAssert(x.size() == y.size());
+    JWAssert(x.size() == w.size());
+
+    const auto* xs = x.data();
+    const auto* ys = y.data();
+    auto* ws = w.data();
+    detail::elementwise(w.size(), [=](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            ws[i] = alpha * xs[i] + beta * ys[i];
+        }
+    });
+
+    return 3 * sizeof(TVal) * w.size();
+}
+
+/** Computes \f$x = \alpha x\f$.
+ * @return the number of bytes moved */
+template <typename TVal, typename TIdx>
+std::size_t scale(TVal alpha, DVector<TVal, TIdx>& x) {
+    auto* xs = x.data();
+    detail::elementwise(x.size(), [=](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            xs[i] *= alpha;
+        }
+    });
+
+    return 2 * sizeof(TVal) * x.size();
+}
+
+/** Computes \f$y = \alpha x\f$.
+ * @return the number of bytes moved */
+template <typename TVal, typename TIdx>
+std::size_t scale(TVal alpha, const DVector<TVal, TIdx>& x,
+                  DVector<TVal, TIdx>& y) {
+    JWAssert(x.size() == y.size());
+
+    const auto* xs = x.data();
+    auto* ys = y.data();
+    detail::elementwise(x.size(), [=](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            ys[i] = alpha * xs[i];
+        }
+    });
+
+    return 2 * sizeof(TVal) * x.size();
+}
+
+/** Computes \f$y = x\f$.
+ * @return the number of bytes moved */
+template <typename TVal, typename TIdx>
+std::size_t copy(const DVector<TVal, TIdx>& x, DVector<TVal, TIdx>& y) {
+    JWAssert(x.size() == y.size());
+
+    const auto* xs = x.data();
+    auto* ys = y.data();
+    detail::elementwise(x.size(), [=](std::size_t begin, std::size_t end) {
+        std::copy(xs + begin, xs + end, ys + begin);
+    });
+
+    return 2 * sizeof(TVal) * x.size();
+}
+
+}  // namespace Zee
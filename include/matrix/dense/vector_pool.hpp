@@ -0,0 +1,112 @@
+/*
+File: include/matrix/dense/vector_pool.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Zee {
+
+/** A workspace of vector buffers, bucketed by their size. Vectors draw their
+ * storage from the pool, and return it when they are destroyed or assigned
+ * to. Repeated computations with vectors of the same dimensions, such as
+ * repeated solves with the same matrix size, therefore reuse memory instead of
+ * allocating it again. */
+template <typename TVal>
+class VectorPool {
+   public:
+    /** By default the pool holds on to at most this many bytes */
+    static constexpr std::size_t default_capacity = (std::size_t)1 << 30;
+
+    /** The pool that is used by `DVector` */
+    static VectorPool& global() {
+        // the pool is never destroyed, so that vectors with static storage
+        // duration can still release their storage to it
+        static auto pool = new VectorPool();
+        return *pool;
+    }
+
+    /** Obtain a buffer of n elements. The contents of a reused buffer are
+     * unspecified. */
+    std::vector<TVal> acquire(std::size_t n) {
+        if (n > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto bucket = buckets_.find(n);
+            if (bucket != buckets_.end() && !bucket->second.empty()) {
+                auto buffer = std::move(bucket->second.back());
+                bucket->second.pop_back();
+                bytes_ -= n * sizeof(TVal);
+                hits_++;
+                return buffer;
+            }
+            misses_++;
+        }
+
+        return std::vector<TVal>(n);
+    }
+
+    /** Return a buffer to the pool. If this would exceed the capacity of the
+     * pool the buffer is deallocated instead. */
+    void release(std::vector<TVal> buffer) {
+        auto bytes = buffer.size() * sizeof(TVal);
+        if (bytes == 0) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytes_ + bytes > capacity_) return;
+        bytes_ += bytes;
+        buckets_[buffer.size()].push_back(std::move(buffer));
+    }
+
+    /** Deallocate all buffers held by the pool */
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buckets_.clear();
+        bytes_ = 0;
+    }
+
+    /** Set the maximum number of bytes the pool holds on to */
+    void setCapacity(std::size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = bytes;
+        if (bytes_ > capacity_) {
+            buckets_.clear();
+            bytes_ = 0;
+        }
+    }
+
+    /** @return the number of bytes currently held by the pool */
+    std::size_t bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    /** @return the number of requests that reused a buffer */
+    std::size_t hits() const { return hits_; }
+
+    /** @return the number of requests that required an allocation */
+    std::size_t misses() const { return misses_; }
+
+   private:
+    mutable std::mutex mutex_;
+    std::map<std::size_t, std::vector<std::vector<TVal>>> buckets_;
+    std::size_t capacity_ = default_capacity;
+    std::size_t bytes_ = 0;
+    std::atomic<std::size_t> hits_{0};
+    std::atomic<std::size_t> misses_{0};
+};
+
+}  // namespace Zee
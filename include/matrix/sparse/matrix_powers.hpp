@@ -0,0 +1,162 @@
+/*
+File: include/matrix/sparse/matrix_powers.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../dense/dense.hpp"
+#include "overlap.hpp"
+#include "sparse.hpp"
+
+namespace Zee {
+
+/** The communication-avoiding matrix powers kernel, which computes
+ * \f$[A x, A^2 x, \ldots, A^s x]\f$ with a single exchange of ghost elements.
+ *
+ * The domain of every image, the indices that it owns, is extended by s
+ * layers of neighbouring indices in the graph of A, starting from the ghost
+ * components of the image, see `OwnedRows`. The image fetches the rows of A
+ * for the first s - 1 layers from their owners once, at construction. When
+ * the kernel is applied it reads the elements of x on its extended domain,
+ * and then computes the powers without further communication: the k-th power
+ * is computed on the first s - k layers, so that its owned elements are
+ * exact.
+ * The price is the redundant work on the layers, which is small as long as
+ * the layers are thin compared to the domains, i.e. for a good partitioning
+ * and a modest s.
+ *
+ * A has to be square and localized with dist(u) = dist(v), as is done by the
+ * `GreedyVectorPartitioner` for square matrices. */
+template <typename TVal, typename TIdx>
+class MatrixPowers {
+   public:
+    MatrixPowers(const DSparseMatrix<TVal, TIdx>& matrix, TIdx s)
+        : n_(matrix.getRows()), s_(s) {
+        using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+        JWAssert(matrix.getRows() == matrix.getCols());
+        JWAssert(matrix.localizedStorage());
+        JWAssert(s > 0);
+
+        detail::OwnedRows<TVal, TIdx> rows(matrix);
+
+        domains_.resize(matrix.getProcs());
+        matrix.compute([&](std::shared_ptr<TImage>, TIdx p) {
+            auto& domain = domains_[p];
+            auto extended = rows.extend(p, s);
+
+            // the local rows, up to and including layer s - 1
+            auto localRows = extended.layerEnd[s - 1];
+            domain.rowStart.push_back(0);
+            for (TIdx l = 0; l < localRows; ++l) {
+                auto range = rows.row(extended.owners[l], extended.indices[l]);
+                for (auto entry = range.first; entry != range.second;
+                     ++entry) {
+                    domain.cols.push_back(extended.position[entry->col]);
+                    domain.values.push_back(entry->value);
+                }
+                domain.rowStart.push_back(domain.cols.size());
+            }
+
+            domain.indices = std::move(extended.indices);
+            domain.layerEnd = std::move(extended.layerEnd);
+        });
+    }
+
+    /** Computes \f$A^k x\f$ for k = 1, ..., s, and stores it in
+     * powers[first + k - 1]. The output vectors should not alias x. */
+    void apply(const DVector<TVal, TIdx>& x,
+               std::vector<DVector<TVal, TIdx>>& powers,
+               TIdx first = 0) const {
+        JWAssert(x.size() == n_);
+        JWAssert(first + s_ <= powers.size());
+        for (TIdx k = 0; k < s_; ++k) {
+            JWAssert(powers[first + k].size() == n_);
+            JWAssert(&powers[first + k] != &x);
+        }
+
+        std::vector<std::thread> threads;
+        for (TIdx p = 1; p < domains_.size(); ++p) {
+            threads.push_back(std::thread(
+                [&, p]() { apply_(domains_[p], x, powers, first); }));
+        }
+        if (!domains_.empty()) apply_(domains_[0], x, powers, first);
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    /** @return the number of powers s */
+    TIdx getPowers() const { return s_; }
+
+    /** @return the number of indices in the extended domain of image p,
+     * including the owned indices */
+    TIdx getDomainSize(TIdx p) const { return domains_[p].indices.size(); }
+
+    /** @return the number of indices owned by image p, and in the first
+     * `layers` layers around them */
+    TIdx getLayerEnd(TIdx p, TIdx layers) const {
+        return domains_[p].layerEnd[layers];
+    }
+
+   private:
+    struct Domain {
+        // the global indices, owned indices first and then layer by layer
+        std::vector<TIdx> indices;
+        // the end of the owned indices, and of each of the s layers
+        std::vector<TIdx> layerEnd;
+        // the local rows in compressed form
+        std::vector<TIdx> rowStart;
+        std::vector<TIdx> cols;
+        std::vector<TVal> values;
+    };
+
+    void apply_(const Domain& domain, const DVector<TVal, TIdx>& x,
+                std::vector<DVector<TVal, TIdx>>& powers, TIdx first) const {
+        // the single exchange: the elements of x on the extended domain
+        std::vector<TVal> current(domain.indices.size());
+        for (std::size_t l = 0; l < current.size(); ++l) {
+            current[l] = x[domain.indices[l]];
+        }
+        std::vector<TVal> next(current.size());
+
+        for (TIdx k = 1; k <= s_; ++k) {
+            auto localRows = domain.layerEnd[s_ - k];
+            for (TIdx l = 0; l < localRows; ++l) {
+                TVal sum = 0;
+                for (auto q = domain.rowStart[l]; q < domain.rowStart[l + 1];
+                     ++q) {
+                    sum += domain.values[q] * current[domain.cols[q]];
+                }
+                next[l] = sum;
+            }
+            std::swap(current, next);
+
+            // the owned elements are written by their owner only
+            auto& power = powers[first + k - 1];
+            for (TIdx l = 0; l < domain.layerEnd[0]; ++l) {
+                power[domain.indices[l]] = current[l];
+            }
+        }
+    }
+
+    TIdx n_;
+    TIdx s_;
+    std::vector<Domain> domains_;
+};
+
+}  // namespace Zee
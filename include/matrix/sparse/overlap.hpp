@@ -0,0 +1,204 @@
+/*
+File: include/matrix/sparse/overlap.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sparse.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** The indices owned by an image, extended by layers of neighbouring indices
+ * in the graph of a matrix */
+template <typename TIdx>
+struct OverlappingDomain {
+    /** The global indices, the owned indices first and then layer by layer */
+    std::vector<TIdx> indices;
+    /** The image that owns each of the indices */
+    std::vector<TIdx> owners;
+    /** The end of the owned indices, and of each of the layers */
+    std::vector<TIdx> layerEnd;
+    /** The position of every global index in `indices` */
+    std::unordered_map<TIdx, TIdx> position;
+};
+
+/** The rows of a square matrix A that is localized with dist(u) = dist(v),
+ * stored by the owners of the row indices. Every image holds the complete rows
+ * of its owned indices, including the entries that are stored on other images:
+ * these are sent to the owners, as the partial sums of an SpMV are. Every
+ * entry records the owner of its column index, so that the rows of the
+ * neighbouring indices can be fetched from their owners, and no image needs
+ * the rows of all of A. */
+template <typename TVal, typename TIdx>
+class OwnedRows {
+   public:
+    struct Entry {
+        TIdx col;
+        TIdx owner;
+        TVal value;
+    };
+
+    explicit OwnedRows(const DSparseMatrix<TVal, TIdx>& matrix)
+        : images_(matrix.getProcs()) {
+        using TImage = typename DSparseMatrix<TVal, TIdx>::image_type;
+
+        JWAssert(matrix.getRows() == matrix.getCols());
+        JWAssert(matrix.localizedStorage());
+
+        auto p = matrix.getProcs();
+
+        // the entries of the owned rows that are stored by the image itself,
+        // and those of the remote rows, by their owner
+        std::vector<std::vector<std::vector<Entry>>> local(p);
+        std::vector<std::vector<std::vector<std::pair<TIdx, Entry>>>> sent(
+            p, std::vector<std::vector<std::pair<TIdx, Entry>>>(p));
+
+        matrix.compute([&](std::shared_ptr<TImage> image, TIdx s) {
+            auto& rows = images_[s];
+            auto& indicesU = image->getLocalIndicesU();
+            auto& indicesV = image->getLocalIndicesV();
+            auto numLocalU = image->getNumLocalU();
+            auto numLocalV = image->getNumLocalV();
+            JWAssert(numLocalU == numLocalV);
+
+            rows.owned.assign(indicesU.begin(), indicesU.begin() + numLocalU);
+            JWAssert(std::is_sorted(rows.owned.begin(), rows.owned.end()));
+            rows.ghosts.assign(indicesV.begin() + numLocalV, indicesV.end());
+            rows.ghostOwners = image->getRemoteOwnersV();
+
+            local[s].resize(numLocalU);
+            for (const auto& triplet : *image) {
+                auto col = triplet.col();
+                Entry entry = {indicesV[col],
+                               (col < numLocalV)
+                                   ? s
+                                   : rows.ghostOwners[col - numLocalV],
+                               triplet.value()};
+
+                auto row = triplet.row();
+                if (row < numLocalU) {
+                    local[s][row].push_back(entry);
+                } else {
+                    auto owner = image->getRemoteOwnersU()[row - numLocalU];
+                    sent[s][owner].push_back(
+                        std::make_pair(indicesU[row], entry));
+                }
+            }
+        });
+
+        matrix.compute([&](std::shared_ptr<TImage>, TIdx s) {
+            auto& rows = images_[s];
+            auto& buckets = local[s];
+            for (TIdx q = 0; q < p; ++q) {
+                for (auto& received : sent[q][s]) {
+                    buckets[position_(rows, received.first)].push_back(
+                        received.second);
+                }
+            }
+
+            rows.start.reserve(buckets.size() + 1);
+            rows.start.push_back(0);
+            for (auto& bucket : buckets) {
+                rows.entries.insert(rows.entries.end(), bucket.begin(),
+                                    bucket.end());
+                rows.start.push_back(rows.entries.size());
+            }
+            buckets = std::vector<std::vector<Entry>>();
+        });
+    }
+
+    /** @return the entries of the row of index i, which is owned by image s */
+    std::pair<const Entry*, const Entry*> row(TIdx s, TIdx i) const {
+        auto& rows = images_[s];
+        auto l = position_(rows, i);
+        auto first = rows.entries.data();
+        return std::make_pair(first + rows.start[l], first + rows.start[l + 1]);
+    }
+
+    /** Extends the indices owned by image s by `layers` layers of neighbouring
+     * indices. The first layer consists of the ghost components of the image
+     * in an SpMV, together with the column indices of the entries of its rows
+     * that are stored by other images. When the rows are stored by their
+     * owners these are exactly the neighbours of the owned indices. The
+     * further layers are found in the rows of their owners. */
+    OverlappingDomain<TIdx> extend(TIdx s, TIdx layers) const {
+        auto& rows = images_[s];
+
+        OverlappingDomain<TIdx> domain;
+        auto add = [&](TIdx i, TIdx owner) {
+            if (domain.position.find(i) != domain.position.end()) return;
+            domain.position[i] = domain.indices.size();
+            domain.indices.push_back(i);
+            domain.owners.push_back(owner);
+        };
+
+        for (auto i : rows.owned) {
+            add(i, s);
+        }
+        domain.layerEnd.push_back(domain.indices.size());
+        if (layers == 0) return domain;
+
+        for (std::size_t k = 0; k < rows.ghosts.size(); ++k) {
+            add(rows.ghosts[k], rows.ghostOwners[k]);
+        }
+        for (auto& entry : rows.entries) {
+            add(entry.col, entry.owner);
+        }
+        domain.layerEnd.push_back(domain.indices.size());
+
+        for (TIdx layer = 1; layer < layers; ++layer) {
+            for (auto l = domain.layerEnd[layer - 1];
+                 l < domain.layerEnd[layer]; ++l) {
+                auto range = row(domain.owners[l], domain.indices[l]);
+                for (auto entry = range.first; entry != range.second;
+                     ++entry) {
+                    add(entry->col, entry->owner);
+                }
+            }
+            domain.layerEnd.push_back(domain.indices.size());
+        }
+
+        return domain;
+    }
+
+   private:
+    struct ImageRows {
+        // the owned indices, ascending
+        std::vector<TIdx> owned;
+        // the remote column indices, and their owners
+        std::vector<TIdx> ghosts;
+        std::vector<TIdx> ghostOwners;
+        // the rows of the owned indices in compressed form
+        std::vector<TIdx> start;
+        std::vector<Entry> entries;
+    };
+
+    static TIdx position_(const ImageRows& rows, TIdx i) {
+        auto it = std::lower_bound(rows.owned.begin(), rows.owned.end(), i);
+        JWAssert(it != rows.owned.end() && *it == i);
+        return it - rows.owned.begin();
+    }
+
+    std::vector<ImageRows> images_;
+};
+
+}  // namespace detail
+
+}  // namespace Zee
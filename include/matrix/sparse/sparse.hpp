@@ -525,6 +525,19 @@ class DSparseMatrix : public DSparseMatrixBase<DSparseMatrix<TVal, TIdx, Image>,
         }
     }
 
+    /** Set new values for the non-zeros, keeping the sparsity pattern, the
+     * distribution and the local indices. This allows a sequence of matrices
+     * with the same structure to be solved without partitioning again. The
+     * function is called as func(i, j, value) with the global indices and the
+     * current value of every non-zero, and returns the new value. Objects
+     * derived from the values, such as preconditioners, have to be rebuilt */
+    template <typename TFunc>
+    void updateValues(TFunc func) {
+        for (auto& image : this->images_) {
+            image->updateValues(func);
+        }
+    }
+
     bool operator==(const DSparseMatrix& other) const {
         auto copy_non_zeros = [](auto& sp_mat) {
             std::vector<Zee::Triplet<TVal, TIdx>> nzs;
@@ -603,6 +616,19 @@ class DSparseMatrixImage {
 
     void clean() { storage_->clean(); }
 
+    /** Replace the value of every non-zero by func(i, j, value), where i and
+     * j are global indices, also after localizing the storage */
+    template <typename TFunc>
+    void updateValues(TFunc& func) {
+        for (auto& triplet : *storage_) {
+            auto i = localizedStorage_ ? localIndicesU_[triplet.row()]
+                                       : triplet.row();
+            auto j = localizedStorage_ ? localIndicesV_[triplet.col()]
+                                       : triplet.col();
+            triplet.setValue(func(i, j, triplet.value()));
+        }
+    }
+
     void setLocalIndices(std::vector<TIdx>&& localIndicesV,
                          std::vector<TIdx>&& localIndicesU) {
         localIndicesV_ = localIndicesV;
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <algorithm>
 #include <vector>
 
@@ -21,34 +23,22 @@ class GreedyVectorPartitioner : public VectorPartitioner<TMatrix, TVector> {
 
         using TIdx = typename TMatrix::index_type;
 
-        // We assign P_v(k) = P_u(k) according to the following scheme:
-        // 1. Assign to P_A(k, k)
-        // 2. If empty, assign to target to some proc in intersection of
-        //    P(k, *) and P(*, k), greedily balancing the assignment load
-        // 3. If empty, assign to target to some proc in union of P(k, *)
-        //    and P(*, k), greedily balancing the assignment load
-
         // We assume the matrix A_ is partitioned
         JWAssert(A.isInitialized());
+        JWAssert(v.size() == A.getCols());
+        JWAssert(u.size() == A.getRows());
 
-        // need to assert matrix A_ is square for this particular solver
-        // TODO figure out how does CGLS work, and how to generalize
-        // dist(u) = dist(v) for those solvers
-        JWAssert(A.getRows() == A.getCols());
-        JWAssert(v.size() == A.getRows());
-        JWAssert(u.size() == v.size());
-
-        TIdx n = v.size();
         TIdx p = A.getProcs();
 
-        std::vector<std::set<TIdx>> processorsInRow(n);
-        std::vector<std::set<TIdx>> processorsInCol(n);
+        std::vector<std::set<TIdx>> processorsInRow(A.getRows());
+        std::vector<std::set<TIdx>> processorsInCol(A.getCols());
 
         // We need to know if diagonal is nonzero
         // FIXME: To parallelize: request diagonals from images
         // can preallocate (distributed) array of size n
         // let them write into that.. or use message queue system
-        std::vector<TIdx> diagonalTargets(n, p);
+        std::vector<TIdx> diagonalTargets(std::min(A.getRows(), A.getCols()),
+                                          p);
 
         TIdx s = 0;
         for (auto& img : A.getImages()) {
@@ -64,6 +54,47 @@ class GreedyVectorPartitioner : public VectorPartitioner<TMatrix, TVector> {
 
         std::vector<TIdx> elementCount(p, 0);
 
+        // the least loaded processor in lookUpSet, or of all processors if
+        // lookUpSet is empty
+        auto lightest = [&](const std::set<TIdx>& lookUpSet) -> TIdx {
+            auto lighter = [&](const TIdx& a, const TIdx& b) {
+                return elementCount[a] < elementCount[b];
+            };
+            if (lookUpSet.empty()) {
+                return std::min_element(elementCount.begin(),
+                                        elementCount.end()) -
+                       elementCount.begin();
+            }
+            return *std::min_element(lookUpSet.begin(), lookUpSet.end(),
+                                     lighter);
+        };
+
+        if (A.getRows() != A.getCols()) {
+            // For rectangular matrices, such as in least-squares problems
+            // solved with CGLS, u and v live in different spaces and their
+            // distributions are chosen independently: v_j goes to a
+            // processor with a non-zero in column j, and u_i to a processor
+            // with a non-zero in row i, greedily balancing the load.
+            for (TIdx j = 0; j < v.size(); ++j) {
+                auto target = lightest(processorsInCol[j]);
+                v.reassign(j, target);
+                elementCount[target]++;
+            }
+            for (TIdx i = 0; i < u.size(); ++i) {
+                auto target = lightest(processorsInRow[i]);
+                u.reassign(i, target);
+                elementCount[target]++;
+            }
+            return;
+        }
+
+        // For square matrices we assign P_v(k) = P_u(k) according to the
+        // following scheme:
+        // 1. Assign to P_A(k, k)
+        // 2. If empty, assign to target to some proc in intersection of
+        //    P(k, *) and P(*, k), greedily balancing the assignment load
+        // 3. If empty, assign to target to some proc in union of P(k, *)
+        //    and P(*, k), greedily balancing the assignment load
         for (TIdx i = 0; i < v.size(); ++i) {
             if (diagonalTargets[i] != p) {
                 v.reassign(i, diagonalTargets[i]);
@@ -81,13 +112,8 @@ class GreedyVectorPartitioner : public VectorPartitioner<TMatrix, TVector> {
                         processorsInCol[i].begin(), processorsInCol[i].end(),
                         std::inserter(lookUpSet, lookUpSet.begin()));
                 }
-                auto minElement = std::min_element(
-                    lookUpSet.begin(), lookUpSet.end(),
-                    [&, elementCount](const TIdx& a, const TIdx& b) {
-                        return elementCount[a] < elementCount[b];
-                    });
 
-                TIdx lightestProc = *minElement;
+                TIdx lightestProc = lightest(lookUpSet);
                 v.reassign(i, lightestProc);
                 u.reassign(i, lightestProc);
                 elementCount[lightestProc]++;
@@ -0,0 +1,589 @@
+/*
+File: include/solvers/amg.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../matrix/dense/dense.hpp"
+#include "../matrix/sparse/sparse.hpp"
+#include "../partitioners/greedy_vector.hpp"
+#include "chebyshev.hpp"
+#include "dense_eigen.hpp"
+#include "preconditioners.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** A sparse matrix with global indices in compressed rows, with sorted column
+ * indices in every row. It is used for the setup of the multigrid hierarchy,
+ * which is done in double precision. */
+template <typename TIdx>
+struct SparseRows {
+    using TEntry = std::pair<TIdx, double>;
+
+    TIdx rows = 0;
+    TIdx cols = 0;
+    std::vector<TIdx> start;
+    std::vector<TIdx> indices;
+    std::vector<double> values;
+
+    /** Sort `entries` by column, and sum the values of equal columns */
+    static void merge(std::vector<TEntry>& entries) {
+        std::sort(entries.begin(), entries.end(),
+                  [](const TEntry& a, const TEntry& b) {
+                      return a.first < b.first;
+                  });
+        std::size_t k = 0;
+        for (std::size_t l = 0; l < entries.size(); ++l) {
+            if (k > 0 && entries[k - 1].first == entries[l].first) {
+                entries[k - 1].second += entries[l].second;
+            } else {
+                entries[k++] = entries[l];
+            }
+        }
+        entries.resize(k);
+    }
+
+    /** Compress rows that were merged already */
+    static SparseRows fromRows(TIdx cols,
+                               const std::vector<std::vector<TEntry>>& rows) {
+        SparseRows result;
+        result.rows = rows.size();
+        result.cols = cols;
+        result.start.reserve(rows.size() + 1);
+        result.start.push_back(0);
+        for (auto& row : rows) {
+            for (auto& entry : row) {
+                result.indices.push_back(entry.first);
+                result.values.push_back(entry.second);
+            }
+            result.start.push_back(result.indices.size());
+        }
+        return result;
+    }
+};
+
+/** @return the non-zeros of A in compressed rows. The non-zeros are bucketed
+ * by row, so this takes time linear in the number of non-zeros, apart from
+ * sorting the (short) rows. */
+template <typename TVal, typename TIdx>
+SparseRows<TIdx> compressRows(const DSparseMatrix<TVal, TIdx>& A) {
+    std::vector<std::vector<typename SparseRows<TIdx>::TEntry>> rows(
+        A.getRows());
+    for (auto& image : A.getImages()) {
+        auto localized = image->localizedStorage();
+        for (const auto& triplet : *image) {
+            auto i = localized ? image->getLocalIndicesU()[triplet.row()]
+                               : triplet.row();
+            auto j = localized ? image->getLocalIndicesV()[triplet.col()]
+                               : triplet.col();
+            rows[i].push_back(std::make_pair(j, (double)triplet.value()));
+        }
+    }
+
+    for (auto& row : rows) {
+        SparseRows<TIdx>::merge(row);
+    }
+    return SparseRows<TIdx>::fromRows(A.getCols(), rows);
+}
+
+/** @return the rows of C = A B, where the rows in each of the blocks are
+ * computed by a separate thread */
+template <typename TIdx>
+SparseRows<TIdx> multiplyRows(const SparseRows<TIdx>& A,
+                              const SparseRows<TIdx>& B,
+                              const std::vector<std::vector<TIdx>>& blocks) {
+    JWAssert(A.cols == B.rows);
+
+    std::vector<std::vector<typename SparseRows<TIdx>::TEntry>> rows(A.rows);
+    forEachBlock(blocks.size(), [&](std::size_t s) {
+        for (auto i : blocks[s]) {
+            auto& row = rows[i];
+            for (auto k = A.start[i]; k < A.start[i + 1]; ++k) {
+                auto l = A.indices[k];
+                for (auto m = B.start[l]; m < B.start[l + 1]; ++m) {
+                    row.push_back(std::make_pair(
+                        B.indices[m], A.values[k] * B.values[m]));
+                }
+            }
+            SparseRows<TIdx>::merge(row);
+        }
+    });
+
+    return SparseRows<TIdx>::fromRows(B.cols, rows);
+}
+
+/** @return the transpose of A */
+template <typename TIdx>
+SparseRows<TIdx> transpose(const SparseRows<TIdx>& A) {
+    SparseRows<TIdx> T;
+    T.rows = A.cols;
+    T.cols = A.rows;
+    T.start.assign(A.cols + 1, 0);
+    for (auto j : A.indices) {
+        T.start[j + 1]++;
+    }
+    for (TIdx j = 0; j < A.cols; ++j) {
+        T.start[j + 1] += T.start[j];
+    }
+
+    // the rows of A are visited in order, so the rows of the transpose are
+    // sorted as well
+    T.indices.resize(A.indices.size());
+    T.values.resize(A.values.size());
+    auto next = T.start;
+    for (TIdx i = 0; i < A.rows; ++i) {
+        for (auto k = A.start[i]; k < A.start[i + 1]; ++k) {
+            auto target = next[A.indices[k]]++;
+            T.indices[target] = i;
+            T.values[target] = A.values[k];
+        }
+    }
+
+    return T;
+}
+
+/** Groups the rows of image s of A into aggregates, by the greedy algorithm of
+ * Vanek, Mandel and Brezina, for the strong connections
+ * \f$|a_{ij}| \geq \theta \sqrt{|a_{ii} a_{jj}|}\f$. Only connections between
+ * rows of the same image are considered, so that an aggregate never crosses
+ * an image boundary. The aggregate of row i, local to the image, is written
+ * to aggregates[i].
+ * @return the number of aggregates of the image */
+template <typename TIdx>
+TIdx aggregateRows(const SparseRows<TIdx>& A,
+                   const std::vector<double>& diagonal,
+                   const std::vector<TIdx>& owners,
+                   const std::vector<TIdx>& rows, TIdx s, double theta,
+                   std::vector<TIdx>& aggregates) {
+    const auto none = (TIdx)-1;
+
+    auto strong = [&](TIdx i, TIdx k) {
+        auto j = A.indices[k];
+        return j != i && owners[j] == s && A.values[k] != 0 &&
+               std::abs(A.values[k]) >=
+                   theta * std::sqrt(std::abs(diagonal[i] * diagonal[j]));
+    };
+
+    for (auto i : rows) {
+        aggregates[i] = none;
+    }
+
+    // 1. a row and its strong neighbourhood form an aggregate, if none of
+    // them has been aggregated yet
+    TIdx count = 0;
+    for (auto i : rows) {
+        if (aggregates[i] != none) continue;
+        bool free = true;
+        for (auto k = A.start[i]; k < A.start[i + 1] && free; ++k) {
+            if (strong(i, k) && aggregates[A.indices[k]] != none) free = false;
+        }
+        if (!free) continue;
+
+        aggregates[i] = count;
+        for (auto k = A.start[i]; k < A.start[i + 1]; ++k) {
+            if (strong(i, k)) aggregates[A.indices[k]] = count;
+        }
+        count++;
+    }
+
+    // 2. the remaining rows join the aggregate of the neighbour they are most
+    // strongly connected to
+    std::vector<TIdx> joined(rows.size(), none);
+    for (std::size_t l = 0; l < rows.size(); ++l) {
+        auto i = rows[l];
+        if (aggregates[i] != none) continue;
+        double strongest = 0;
+        for (auto k = A.start[i]; k < A.start[i + 1]; ++k) {
+            auto j = A.indices[k];
+            if (strong(i, k) && aggregates[j] != none &&
+                std::abs(A.values[k]) > strongest) {
+                strongest = std::abs(A.values[k]);
+                joined[l] = aggregates[j];
+            }
+        }
+    }
+    for (std::size_t l = 0; l < rows.size(); ++l) {
+        if (joined[l] != none) aggregates[rows[l]] = joined[l];
+    }
+
+    // 3. and what is left is aggregated with its free strong neighbours
+    for (auto i : rows) {
+        if (aggregates[i] != none) continue;
+        aggregates[i] = count;
+        for (auto k = A.start[i]; k < A.start[i + 1]; ++k) {
+            if (strong(i, k) && aggregates[A.indices[k]] == none) {
+                aggregates[A.indices[k]] = count;
+            }
+        }
+        count++;
+    }
+
+    return count;
+}
+
+}  // namespace detail
+
+/** A smoothed aggregation algebraic multigrid (SA-AMG) preconditioner, for
+ * symmetric positive definite matrices such as discretized diffusion
+ * problems. Applying it performs one V-cycle.
+ *
+ * The hierarchy is built from the partitioning of A, which has to be
+ * localized with the same distribution for u and v. Every image aggregates
+ * its own rows, so aggregates do not cross image boundaries, and the
+ * aggregates of an image are owned by it on the next level. The tentative
+ * prolongator is smoothed by a damped Jacobi step,
+ * \f$P = (I - \omega D^{-1} A) P_0\f$ with \f$\omega = 4 / (3
+ * \lambda_{\max})\f$, and the coarse matrix is the Galerkin product
+ * \f$P^T A P\f$. Both are computed by a thread per image, or per block of
+ * aggregates.
+ *
+ * The coarse levels use fewer images, at least `rowsPerImage` rows each, since
+ * otherwise the communication of the SpMVs would dominate the little work
+ * there is to do. The coarse rows are assigned to the images of the next level
+ * in the order of the images that own them, and the vectors are distributed
+ * by the `GreedyVectorPartitioner`. Coarsening stops at `coarseRows` rows, or
+ * when it no longer reduces the number of rows, and the coarsest level is
+ * solved by a dense LU factorization.
+ *
+ * The pre- and post-smoother are Chebyshev smoothers, so that the V-cycle is
+ * symmetric, and can be used with CG.
+ *
+ * The preconditioner holds a reference to A, which has to outlive it. */
+template <typename TVal, typename TIdx>
+class AMGPreconditioner {
+    using TMatrix = DSparseMatrix<TVal, TIdx>;
+    using TVector = DVector<TVal, TIdx>;
+
+   public:
+    AMGPreconditioner(TMatrix& A, TIdx smootherDegree = 3,
+                      double strength = 0.08, TIdx coarseRows = 200,
+                      TIdx rowsPerImage = 500, TIdx maxLevels = 10) {
+        JWAssert(A.getRows() == A.getCols());
+        JWAssert(A.localizedStorage());
+
+        levels_.emplace_back();
+        levels_.back().A = &A;
+
+        while (true) {
+            auto& level = levels_.back();
+            level.smoother =
+                std::make_unique<ChebyshevPreconditioner<TVal, TIdx>>(
+                    *level.A, smootherDegree, (TVal)30);
+
+            if (level.A->getRows() <= coarseRows ||
+                (TIdx)levels_.size() >= maxLevels) {
+                break;
+            }
+
+            auto next = coarsen_(level, strength, rowsPerImage);
+            if (!next) break;
+            levels_.push_back(std::move(*next));
+        }
+
+        auto& coarsest = *levels_.back().A;
+        auto n = coarsest.getRows();
+        if (n <= maxDirectRows_) {
+            auto rows = detail::compressRows(coarsest);
+            std::vector<double> dense(n * n, 0);
+            for (TIdx i = 0; i < n; ++i) {
+                for (auto k = rows.start[i]; k < rows.start[i + 1]; ++k) {
+                    dense[rows.indices[k] * n + i] = rows.values[k];
+                }
+            }
+            coarseSolver_ = detail::DenseLU<double>(n, std::move(dense));
+        }
+    }
+
+    /** Computes \f$z = M^{-1} r\f$, by a V-cycle with initial guess zero */
+    void apply(const TVector& r, TVector& z) const {
+        JWAssert(r.size() == levels_[0].A->getRows());
+        JWAssert(z.size() == r.size());
+
+        cycle_(0, r, z);
+    }
+
+    /** @return the number of levels, including A itself */
+    TIdx getLevels() const { return levels_.size(); }
+
+    /** @return the number of rows of the matrix of `level` */
+    TIdx getRows(TIdx level) const { return levels_[level].A->getRows(); }
+
+    /** @return the number of images of the matrix of `level` */
+    TIdx getImages(TIdx level) const { return levels_[level].A->getProcs(); }
+
+    /** @return the total number of non-zeros of all levels, relative to that
+     * of A */
+    double getOperatorComplexity() const {
+        double total = 0;
+        for (auto& level : levels_) {
+            total += level.A->nonZeros();
+        }
+        return total / levels_[0].A->nonZeros();
+    }
+
+   private:
+    struct Level {
+        TMatrix* A = nullptr;
+        // the matrices of the coarse levels are owned by the preconditioner
+        std::unique_ptr<TMatrix> ownedA;
+        std::unique_ptr<ChebyshevPreconditioner<TVal, TIdx>> smoother;
+        // the prolongation from the next level to this one
+        std::unique_ptr<TMatrix> P;
+    };
+
+    /** @return the next level, or nullptr if the rows of A hardly coarsen */
+    std::unique_ptr<Level> coarsen_(Level& level, double strength,
+                                    TIdx rowsPerImage) {
+        auto& A = *level.A;
+        auto n = A.getRows();
+        auto p = A.getProcs();
+
+        // the rows owned by every image
+        std::vector<std::vector<TIdx>> ownedRows(p);
+        std::vector<TIdx> owners(n, 0);
+        for (TIdx s = 0; s < p; ++s) {
+            auto& image = A.getImages()[s];
+            auto& indices = image->getLocalIndicesU();
+            ownedRows[s].assign(indices.begin(),
+                                indices.begin() + image->getNumLocalU());
+            for (auto i : ownedRows[s]) {
+                owners[i] = s;
+            }
+        }
+
+        auto C = detail::compressRows(A);
+        std::vector<double> diagonal(n, 0);
+        for (TIdx i = 0; i < n; ++i) {
+            for (auto k = C.start[i]; k < C.start[i + 1]; ++k) {
+                if (C.indices[k] == i) diagonal[i] = C.values[k];
+            }
+            if (diagonal[i] == 0) diagonal[i] = 1;
+        }
+
+        // aggregate the rows of every image, and number the aggregates of an
+        // image consecutively
+        std::vector<TIdx> aggregates(n);
+        std::vector<TIdx> offsets(p + 1, 0);
+        detail::forEachBlock(p, [&](std::size_t s) {
+            offsets[s + 1] =
+                detail::aggregateRows(C, diagonal, owners, ownedRows[s],
+                                      (TIdx)s, strength, aggregates);
+        });
+        for (TIdx s = 0; s < p; ++s) {
+            offsets[s + 1] += offsets[s];
+        }
+        auto nc = offsets[p];
+        if (nc == 0 || 10 * nc > 9 * n) return nullptr;
+
+        std::vector<TIdx> sizes(nc, 0);
+        for (TIdx i = 0; i < n; ++i) {
+            aggregates[i] += offsets[owners[i]];
+            sizes[aggregates[i]]++;
+        }
+
+        // the smoothed prolongator P = (I - omega D^{-1} A) P_0, where the
+        // columns of the tentative prolongator P_0 are the normalized
+        // indicator vectors of the aggregates
+        auto omega = 4 / (3 * (double)level.smoother->getBounds().second);
+        std::vector<std::vector<typename detail::SparseRows<TIdx>::TEntry>>
+            rows(n);
+        detail::forEachBlock(p, [&](std::size_t s) {
+            for (auto i : ownedRows[s]) {
+                auto& row = rows[i];
+                auto tentative = 1 / std::sqrt((double)sizes[aggregates[i]]);
+                row.push_back(std::make_pair(aggregates[i], tentative));
+                for (auto k = C.start[i]; k < C.start[i + 1]; ++k) {
+                    auto j = C.indices[k];
+                    row.push_back(std::make_pair(
+                        aggregates[j],
+                        -omega * C.values[k] / diagonal[i] /
+                            std::sqrt((double)sizes[aggregates[j]])));
+                }
+                detail::SparseRows<TIdx>::merge(row);
+            }
+        });
+        auto P = detail::SparseRows<TIdx>::fromRows(nc, rows);
+        rows.clear();
+
+        // the Galerkin product P^T (A P), where the rows of P^T are the
+        // aggregates, which are grouped by image as well
+        auto AP = detail::multiplyRows(C, P, ownedRows);
+        std::vector<std::vector<TIdx>> ownedAggregates(p);
+        for (TIdx s = 0; s < p; ++s) {
+            for (auto J = offsets[s]; J < offsets[s + 1]; ++J) {
+                ownedAggregates[s].push_back(J);
+            }
+        }
+        auto Ac = detail::multiplyRows(detail::transpose(P), AP,
+                                       ownedAggregates);
+
+        auto next = std::make_unique<Level>();
+        next->ownedA = coarseMatrix_(Ac, offsets, rowsPerImage);
+        next->A = next->ownedA.get();
+        level.P = prolongation_(P, owners, ownedRows, offsets);
+
+        return next;
+    }
+
+    /** @return the coarse matrix, distributed over fewer images in the order
+     * of the images that own the aggregates, and localized */
+    std::unique_ptr<TMatrix> coarseMatrix_(const detail::SparseRows<TIdx>& Ac,
+                                           const std::vector<TIdx>& offsets,
+                                           TIdx rowsPerImage) {
+        auto nc = Ac.rows;
+        auto p = (TIdx)offsets.size() - 1;
+        auto pc = std::max(std::min(p, nc / std::max(rowsPerImage, (TIdx)1)),
+                           (TIdx)1);
+
+        std::vector<TIdx> targets(nc);
+        for (TIdx s = 0; s < p; ++s) {
+            for (auto J = offsets[s]; J < offsets[s + 1]; ++J) {
+                targets[J] = (s * pc) / p;
+            }
+        }
+
+        std::vector<Triplet<TVal, TIdx>> triplets;
+        triplets.reserve(Ac.indices.size());
+        for (TIdx I = 0; I < nc; ++I) {
+            for (auto k = Ac.start[I]; k < Ac.start[I + 1]; ++k) {
+                triplets.push_back(
+                    Triplet<TVal, TIdx>(I, Ac.indices[k], (TVal)Ac.values[k]));
+            }
+        }
+
+        auto coarse = std::make_unique<TMatrix>(nc, nc);
+        coarse->setDistributionScheme(partitioning_scheme::custom, pc);
+        coarse->setDistributionFunction(
+            [&targets](TIdx I, TIdx) { return targets[I]; });
+        coarse->setFromTriplets(triplets.begin(), triplets.end());
+
+        TVector v(nc);
+        TVector u(nc);
+        GreedyVectorPartitioner<TMatrix, TVector> partitioner(*coarse, v, u);
+        partitioner.partition();
+        partitioner.localizeMatrix();
+
+        return coarse;
+    }
+
+    /** @return the prolongator as a matrix with the images of the fine level,
+     * where every image holds the rows that it owns, and owns the columns of
+     * its aggregates */
+    std::unique_ptr<TMatrix> prolongation_(
+        const detail::SparseRows<TIdx>& P, const std::vector<TIdx>& owners,
+        const std::vector<std::vector<TIdx>>& ownedRows,
+        const std::vector<TIdx>& offsets) {
+        auto n = P.rows;
+        auto nc = P.cols;
+        auto p = (TIdx)ownedRows.size();
+
+        std::vector<Triplet<TVal, TIdx>> triplets;
+        triplets.reserve(P.indices.size());
+        for (TIdx i = 0; i < n; ++i) {
+            for (auto k = P.start[i]; k < P.start[i + 1]; ++k) {
+                triplets.push_back(
+                    Triplet<TVal, TIdx>(i, P.indices[k], (TVal)P.values[k]));
+            }
+        }
+
+        auto prolongation = std::make_unique<TMatrix>(n, nc);
+        prolongation->setDistributionScheme(partitioning_scheme::custom, p);
+        prolongation->setDistributionFunction(
+            [&owners](TIdx i, TIdx) { return owners[i]; });
+        prolongation->setFromTriplets(triplets.begin(), triplets.end());
+
+        std::vector<TIdx> aggregateOwners(nc);
+        for (TIdx s = 0; s < p; ++s) {
+            std::fill(aggregateOwners.begin() + offsets[s],
+                      aggregateOwners.begin() + offsets[s + 1], s);
+        }
+
+        for (TIdx s = 0; s < p; ++s) {
+            auto& image = prolongation->getMutableImages()[s];
+            std::vector<TIdx> ownedV;
+            for (auto J = offsets[s]; J < offsets[s + 1]; ++J) {
+                ownedV.push_back(J);
+            }
+            auto ownedU = ownedRows[s];
+            std::sort(ownedU.begin(), ownedU.end());
+            image->setLocalIndices(std::move(ownedV), std::move(ownedU));
+
+            auto& indicesV = image->getLocalIndicesV();
+            for (auto idx = image->getNumLocalV(); idx < indicesV.size();
+                 ++idx) {
+                image->getRemoteOwnersV().push_back(
+                    aggregateOwners[indicesV[idx]]);
+            }
+            image->localizeStorage();
+        }
+
+        return prolongation;
+    }
+
+    /** Approximately solves \f$A_l x = b\f$ for the matrix of `level` */
+    void cycle_(std::size_t level, const TVector& b, TVector& x) const {
+        auto& current = levels_[level];
+
+        if (level + 1 == levels_.size()) {
+            if (coarseSolver_.size() == 0) {
+                // the coarsest level is too large for a direct solve
+                current.smoother->apply(b, x);
+                return;
+            }
+
+            std::vector<double> values(b.size());
+            for (TIdx i = 0; i < b.size(); ++i) {
+                values[i] = b[i];
+            }
+            coarseSolver_.solve(values);
+            for (TIdx i = 0; i < x.size(); ++i) {
+                x[i] = (TVal)values[i];
+            }
+            return;
+        }
+
+        auto& A = *current.A;
+        auto& P = *current.P;
+
+        current.smoother->apply(b, x);
+
+        auto r = TVector::uninitialized(b.size());
+        r = b - A * x;
+        auto bc = TVector::uninitialized(P.getCols());
+        multiplyTransposed(P, r, bc);
+
+        TVector xc(P.getCols());
+        cycle_(level + 1, bc, xc);
+
+        auto correction = TVector::uninitialized(x.size());
+        correction = P * xc;
+        axpby((TVal)1, correction, (TVal)1, x);
+
+        current.smoother->smooth(b, x);
+    }
+
+    std::vector<Level> levels_;
+    detail::DenseLU<double> coarseSolver_;
+
+    // the largest coarsest level that is factored
+    static constexpr TIdx maxDirectRows_ = 2000;
+};
+
+}  // namespace Zee
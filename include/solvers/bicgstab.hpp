@@ -0,0 +1,211 @@
+/*
+File: include/solvers/bicgstab.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "preconditioners.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace BiCGStab {
+
+/** Solve Ax = b using the right-preconditioned BiCGStab method with
+ * preconditioner M.
+ *
+ * BiCGStab uses short recurrences, so the memory is a fixed number of vectors
+ * of size n regardless of the number of iterations. Every iteration takes two
+ * SpMVs and three reductions: the inner products that are needed at the same
+ * time, \f$(\langle s, t \rangle, \langle t, t \rangle)\f$ and
+ * \f$(\langle \hat{r}_0, r \rangle, \langle r, r \rangle)\f$, are each
+ * computed by a single block reduction.
+ *
+ * The solve is recorded in `statistics`, as for `GMRES::solve`.
+ * @return the residual norm before the first iteration, and after each
+ * iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx max_iterations, TVal tol,
+                        SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (BiCGStab)" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+
+    statistics.start();
+
+    TVector r(n);
+    r = b - A * x;
+    statistics.countSpMV();
+    statistics.lap(phase::spmv);
+
+    // the shadow residual
+    TVector rHat = r;
+
+    TVector p = r;
+    TVector pHat(n);
+    TVector v(n);
+    TVector s(n);
+    TVector sHat(n);
+    TVector t(n);
+
+    TVal products[2];
+    auto reduce = [&](const TVector& first, const TVector& second) {
+        const TVal* columns[] = {first.data(), second.data()};
+        detail::multiDot<TVal>(n, columns, 2, second.data(), products);
+        statistics.countReduction(2);
+        statistics.lap(phase::synchronization);
+    };
+    statistics.lap(phase::vector_update);
+
+    reduce(rHat, r);
+    auto rho = products[0];
+
+    std::vector<TVal> rhos;
+    rhos.push_back(std::sqrt(products[1]));
+
+    for (TIdx k = 0; k < max_iterations && rhos.back() >= tol; ++k) {
+        M.apply(p, pHat);
+        statistics.lap(phase::preconditioning);
+        v = A * pHat;
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+
+        auto rHatV = rHat.dot(v);
+        statistics.countReduction();
+        statistics.lap(phase::synchronization);
+        if (rho == 0 || rHatV == 0) {
+            JWLogError << "BiCGStab: breakdown in iteration " << k << endLog;
+            break;
+        }
+
+        auto alpha = rho / rHatV;
+        Zee::waxpby((TVal)1, r, -alpha, v, s);
+        statistics.lap(phase::vector_update);
+
+        M.apply(s, sHat);
+        statistics.lap(phase::preconditioning);
+        t = A * sHat;
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+
+        // <s, t> and <t, t>
+        reduce(s, t);
+        auto omega =
+            (products[1] == 0) ? (TVal)0 : products[0] / products[1];
+
+        Zee::axpby(alpha, pHat, (TVal)1, x);
+        Zee::axpby(omega, sHat, (TVal)1, x);
+        Zee::waxpby((TVal)1, s, -omega, t, r);
+        statistics.lap(phase::vector_update);
+
+        // <rHat, r> and <r, r>
+        reduce(rHat, r);
+        rhos.push_back(std::sqrt(products[1]));
+        statistics.addIteration(rhos.back());
+
+        if (omega == 0) {
+            if (rhos.back() >= tol) {
+                JWLogError << "BiCGStab: stagnation in iteration " << k
+                           << endLog;
+            }
+            break;
+        }
+
+        auto beta = (products[0] / rho) * (alpha / omega);
+        rho = products[0];
+
+        // p = r + beta (p - omega v)
+        Zee::axpby(-omega, v, (TVal)1, p);
+        Zee::axpby((TVal)1, r, beta, p);
+        statistics.lap(phase::vector_update);
+    }
+
+    statistics.finish();
+
+    return rhos;
+}
+
+/** Solve Ax = b using the right-preconditioned BiCGStab method with
+ * preconditioner M.
+ * @return the residual norm before the first iteration, and after each
+ * iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx max_iterations, TVal tol,
+                        bool plotResiduals = false, bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solve(A, b, x, M, max_iterations, tol, statistics);
+
+    if (benchmark) statistics.report("BiCGStab");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto plot = Zee::Plotter<TVal>();
+        plot["xlabel"] = "iterations";
+        plot["ylabel"] = "$\\|r\\|$";
+        plot["yscale"] = "log";
+        plot["title"] = "BiCGStab: residual norm";
+        plot.addLine(rhos, "rhos");
+        plot.plot("residual_test_bicgstab", true);
+    }
+
+    return rhos;
+}
+
+/** Solve Ax = b using the unpreconditioned BiCGStab method, recording the
+ * solve in `statistics` */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, SolverStatistics<TVal>& statistics) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, statistics);
+}
+
+/** Solve Ax = b using the unpreconditioned BiCGStab method */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, bool plotResiduals = false,
+                        bool benchmark = false) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, plotResiduals, benchmark);
+}
+
+}  // namespace BiCGStab
+
+}  // namespace Zee
@@ -0,0 +1,276 @@
+/*
+File: include/solvers/block_gmres.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "hessenberg.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace GMRES {
+
+/** Solve AX = B for a block of right-hand sides using restarted block
+ * GMRES(m), with m = inner_iterations block steps per cycle.
+ *
+ * The block Krylov space of the residuals is built with SpMMs, which read the
+ * matrix once for the entire block, see `multiplyBlock`. Every new block is
+ * orthogonalized against the basis by block CGS2, and within the block by
+ * TSQR, so that a block step takes two block reductions and the reduction of
+ * TSQR, independent of the number of right-hand sides.
+ * The residual norm of every right-hand side is monitored separately. A cycle
+ * ends when all of them are below the tolerance, and at every restart the
+ * right-hand sides that have converged are deflated: they are removed from
+ * the block, so that the next cycle only works on the others.
+ *
+ * If a new block is (numerically) rank deficient the cycle is ended, and the
+ * block Krylov space is rebuilt from the residuals.
+ *
+ * The solve is recorded in `statistics`, with the largest residual norm
+ * estimate of the active right-hand sides for every block step. An SpMM
+ * counts as one SpMV for every vector of the block, and TSQR as a single
+ * reduction of its triangular factor.
+ * @return for every right-hand side, the residual norm estimate after each
+ * block step in which it was active */
+template <typename TVal, typename TIdx>
+std::vector<std::vector<TVal>> solveBlock(
+    Zee::DSparseMatrix<TVal, TIdx>& A,
+    const std::vector<Zee::DVector<TVal, TIdx>>& B,
+    std::vector<Zee::DVector<TVal, TIdx>>& X, TIdx outer_iterations,
+    TIdx inner_iterations, TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving AX = B for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros() << " non-zeros and "
+              << B.size() << " right-hand sides (block)" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(X.size() == B.size());
+    for (std::size_t c = 0; c < B.size(); ++c) {
+        JWAssert(A.getRows() == B[c].size());
+        JWAssert(A.getCols() == X[c].size());
+    }
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+
+    statistics.start();
+
+    // below this fraction of its norm a new basis vector is dependent
+    const auto cancellation = std::sqrt(std::numeric_limits<TVal>::epsilon());
+
+    std::vector<std::vector<TVal>> rhos(B.size());
+    std::vector<std::size_t> active(B.size());
+    for (std::size_t c = 0; c < B.size(); ++c) {
+        active[c] = c;
+    }
+    TIdx breakdowns = 0;
+
+    // the number of values in the triangular factor of TSQR
+    auto triangle = [](std::size_t k) { return k * (k + 1) / 2; };
+
+    for (TIdx run = 0;; ++run) {
+        if (run > 0) statistics.countRestart();
+
+        // the residuals of the active right-hand sides
+        std::vector<TVector> block(active.size(), TVector(n));
+        for (std::size_t l = 0; l < active.size(); ++l) {
+            Zee::copy(X[active[l]], block[l]);
+        }
+        std::vector<TVector> R(active.size(), TVector(n));
+        statistics.lap(phase::vector_update);
+        Zee::multiplyBlock(A, block, R);
+        statistics.countSpMV(active.size());
+        statistics.lap(phase::spmv);
+
+        // deflate the converged right-hand sides
+        std::vector<std::size_t> remaining;
+        std::vector<TVector> residuals;
+        for (std::size_t l = 0; l < active.size(); ++l) {
+            Zee::axpby((TVal)1, B[active[l]], (TVal)-1, R[l]);
+            auto norm = R[l].norm();
+            statistics.countReduction();
+            if (norm < tol) continue;
+            remaining.push_back(active[l]);
+            residuals.push_back(std::move(R[l]));
+        }
+        statistics.lap(phase::synchronization);
+        active = remaining;
+        if (active.empty() || run == outer_iterations) break;
+
+        auto p = (TIdx)active.size();
+        auto m = std::min(inner_iterations, std::max(n / p, (TIdx)1) - 1);
+        m = std::max(m, (TIdx)1);
+
+        // the basis, one block at a time
+        std::vector<std::vector<TVector>> V;
+        V.reserve(m + 1);
+        V.push_back(std::move(residuals));
+        auto S = Zee::tsqr(V[0]);
+        statistics.countReduction(triangle(p));
+        statistics.lap(phase::orthogonalization);
+
+        detail::BlockHessenbergLeastSquares<TVal> leastSquares(m * p, p);
+        leastSquares.reset(S.data());
+
+        std::vector<const TVal*> basis;
+        std::vector<TVal*> columnsW(p);
+        std::vector<TVal> h((m + 1) * p + 1);
+        std::vector<TVal> coefficients(m * p * p);
+        std::vector<TVal> correction(m * p * p);
+
+        for (TIdx j = 0; j < m; ++j) {
+            for (auto& v : V[j]) {
+                basis.push_back(v.data());
+            }
+            auto columns = basis.size();
+
+            V.push_back(std::vector<TVector>(p, TVector(n)));
+            auto& W = V[j + 1];
+            statistics.lap(phase::other);
+            Zee::multiplyBlock(A, V[j], W);
+            statistics.countSpMV(p);
+            statistics.lap(phase::spmv);
+
+            // block CGS2 against the basis, where every pass is a single
+            // block reduction and a single block update, and TSQR within
+            // the block. The coefficients of column l start at l * columns.
+            for (TIdx l = 0; l < p; ++l) {
+                columnsW[l] = W[l].data();
+            }
+            auto size = columns * p;
+            detail::blockDot<TVal>(n, basis.data(), columns, columnsW.data(),
+                                   p, coefficients.data());
+            detail::blockAxpy<TVal>(n, (TVal)-1, basis.data(), columns,
+                                    coefficients.data(), columnsW.data(), p);
+            detail::blockDot<TVal>(n, basis.data(), columns, columnsW.data(),
+                                   p, correction.data());
+            detail::blockAxpy<TVal>(n, (TVal)-1, basis.data(), columns,
+                                    correction.data(), columnsW.data(), p);
+            for (std::size_t i = 0; i < size; ++i) {
+                coefficients[i] += correction[i];
+            }
+            statistics.countReduction(size);
+            statistics.countReduction(size);
+            auto T = Zee::tsqr(W);
+            statistics.countReduction(triangle(p));
+            statistics.lap(phase::orthogonalization);
+
+            auto dependent = false;
+            for (TIdx l = 0; l < p; ++l) {
+                auto first = coefficients.begin() + l * columns;
+                std::fill(h.begin(), h.end(), (TVal)0);
+                std::copy(first, first + columns, h.begin());
+                for (TIdx i = 0; i <= l; ++i) {
+                    h[columns + i] = T[l * p + i];
+                }
+                leastSquares.addColumn(h.data());
+
+                // the norm of the new column before the orthogonalization
+                // follows from its coefficients in the basis and in Q
+                TVal squaredNorm = 0;
+                for (std::size_t i = 0; i < columns + l + 1; ++i) {
+                    squaredNorm += h[i] * h[i];
+                }
+                if (T[l * p + l] <= cancellation * std::sqrt(squaredNorm))
+                    dependent = true;
+            }
+
+            auto converged = true;
+            auto largest = (TVal)0;
+            for (TIdx l = 0; l < p; ++l) {
+                auto rho = leastSquares.residual(l);
+                rhos[active[l]].push_back(rho);
+                largest = std::max(largest, rho);
+                if (rho >= tol) converged = false;
+            }
+            statistics.addIteration(largest);
+
+            if (converged) break;
+            if (dependent) {
+                breakdowns++;
+                break;
+            }
+        }
+
+        // X = X + V Y
+        auto Y = leastSquares.solve();
+        auto k = leastSquares.size();
+        statistics.lap(phase::other);
+        for (TIdx l = 0; l < p; ++l) {
+            detail::multiAxpy<TVal>(n, (TVal)1, basis.data(), k,
+                                    Y.data() + l * k, X[active[l]].data());
+        }
+        statistics.lap(phase::vector_update);
+    }
+
+    if (!active.empty()) {
+        JWLogInfo << "Block GMRES: " << active.size()
+                  << " right-hand side(s) did not converge" << endLog;
+    }
+    if (breakdowns > 0) {
+        JWLogInfo << "Block GMRES restarted " << breakdowns
+                  << " time(s) on a rank-deficient block" << endLog;
+    }
+
+    statistics.finish();
+
+    return rhos;
+}
+
+/** Solve AX = B for a block of right-hand sides using restarted block
+ * GMRES(m), with m = inner_iterations block steps per cycle.
+ * @return for every right-hand side, the residual norm estimate after each
+ * block step in which it was active */
+template <typename TVal, typename TIdx>
+std::vector<std::vector<TVal>> solveBlock(
+    Zee::DSparseMatrix<TVal, TIdx>& A,
+    const std::vector<Zee::DVector<TVal, TIdx>>& B,
+    std::vector<Zee::DVector<TVal, TIdx>>& X, TIdx outer_iterations,
+    TIdx inner_iterations, TVal tol, bool plotResiduals = false,
+    bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solveBlock(A, B, X, outer_iterations, inner_iterations, tol,
+                           statistics);
+
+    if (benchmark) statistics.report("block GMRES");
+
+    if (plotResiduals) {
+        auto plot = Zee::Plotter<TVal>();
+        plot["xlabel"] = "block iterations";
+        plot["ylabel"] = "$\\rho$";
+        plot["yscale"] = "log";
+        plot["title"] = "Block GMRES: residual norms";
+        for (std::size_t c = 0; c < rhos.size(); ++c) {
+            plot.addLine(rhos[c], "rhs " + std::to_string(c));
+        }
+        plot.plot("residual_test_block", true);
+    }
+
+    return rhos;
+}
+
+}  // namespace GMRES
+
+}  // namespace Zee
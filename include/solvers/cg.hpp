@@ -0,0 +1,180 @@
+/*
+File: include/solvers/cg.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "preconditioners.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace CG {
+
+/** Solve Ax = b for a symmetric positive definite matrix A, using the
+ * preconditioned conjugate gradient method with preconditioner M.
+ *
+ * Only five vectors of size n are stored. The product Ap and the inner product
+ * \f$\langle p, A p \rangle\f$ are computed in one pass by `multiplyDot`, and
+ * \f$\langle r, r \rangle\f$ and \f$\langle r, z \rangle\f$ share a single
+ * block reduction.
+ *
+ * The solve is recorded in `statistics`, as for `GMRES::solve`.
+ * @return the residual norm before the first iteration, and after each
+ * iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx max_iterations, TVal tol,
+                        SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (CG)" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+
+    statistics.start();
+
+    TVector r(n);
+    r = b - A * x;
+    statistics.countSpMV();
+    statistics.lap(phase::spmv);
+
+    TVector z(n);
+    TVector p(n);
+    TVector q(n);
+
+    // computes <r, r> and <r, z> together
+    TVal products[2];
+    const TVal* columns[] = {r.data(), z.data()};
+    auto reduce = [&]() {
+        detail::multiDot<TVal>(n, columns, 2, r.data(), products);
+        statistics.countReduction(2);
+        statistics.lap(phase::synchronization);
+    };
+
+    M.apply(r, z);
+    statistics.lap(phase::preconditioning);
+    reduce();
+    Zee::copy(z, p);
+    statistics.lap(phase::vector_update);
+
+    auto rz = products[1];
+
+    std::vector<TVal> rhos;
+    rhos.push_back(std::sqrt(products[0]));
+
+    for (TIdx k = 0; k < max_iterations && rhos.back() >= tol; ++k) {
+        auto pq = Zee::multiplyDot(A, p, q);
+        statistics.countSpMV();
+        statistics.countReduction();
+        statistics.lap(phase::spmv);
+        if (pq <= 0) {
+            JWLogError << "CG: A is not positive definite" << endLog;
+            break;
+        }
+
+        auto alpha = rz / pq;
+        Zee::axpby(alpha, p, (TVal)1, x);
+        Zee::axpby(-alpha, q, (TVal)1, r);
+        statistics.lap(phase::vector_update);
+
+        M.apply(r, z);
+        statistics.lap(phase::preconditioning);
+        reduce();
+        rhos.push_back(std::sqrt(products[0]));
+        statistics.addIteration(rhos.back());
+
+        auto beta = products[1] / rz;
+        rz = products[1];
+        Zee::axpby((TVal)1, z, beta, p);
+        statistics.lap(phase::vector_update);
+    }
+
+    statistics.finish();
+
+    return rhos;
+}
+
+/** Solve Ax = b for a symmetric positive definite matrix A, using the
+ * preconditioned conjugate gradient method with preconditioner M.
+ * @return the residual norm before the first iteration, and after each
+ * iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx max_iterations, TVal tol,
+                        bool plotResiduals = false, bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solve(A, b, x, M, max_iterations, tol, statistics);
+
+    if (benchmark) statistics.report("CG");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto plot = Zee::Plotter<TVal>();
+        plot["xlabel"] = "iterations";
+        plot["ylabel"] = "$\\|r\\|$";
+        plot["yscale"] = "log";
+        plot["title"] = "CG: residual norm";
+        plot.addLine(rhos, "rhos");
+        plot.plot("residual_test_cg", true);
+    }
+
+    return rhos;
+}
+
+/** Solve Ax = b for a symmetric positive definite matrix A, using the
+ * unpreconditioned conjugate gradient method, recording the solve in
+ * `statistics` */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, SolverStatistics<TVal>& statistics) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, statistics);
+}
+
+/** Solve Ax = b for a symmetric positive definite matrix A, using the
+ * unpreconditioned conjugate gradient method */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, bool plotResiduals = false,
+                        bool benchmark = false) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, plotResiduals, benchmark);
+}
+
+}  // namespace CG
+
+}  // namespace Zee
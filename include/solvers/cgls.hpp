@@ -0,0 +1,147 @@
+/*
+File: include/solvers/cgls.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <vector>
+
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace CGLS {
+
+/** Solve the least-squares problem \f$\min_x \| b - A x \|\f$ for a
+ * (rectangular) m x n matrix A, using CG on the normal equations
+ * \f$A^T A x = A^T b\f$.
+ *
+ * The normal equations are never formed: every iteration computes one product
+ * with A and one with \f$A^T\f$ on the same images, using
+ * `multiplyTransposed` for the latter. The vectors x of size n and b of size m
+ * may have different distributions, as obtained by localizing A with a
+ * vector partitioner for (x, b).
+ *
+ * The solve is recorded in `statistics`, where the products with A and
+ * \f$A^T\f$ each count as an SpMV.
+ * @return the norm of the residual of the normal equations,
+ * \f$\| A^T (b - A x) \|\f$, before the first iteration and after each
+ * iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving min ||b - Ax|| for system of size " << A.getRows()
+              << " x " << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (CGLS)" << endLog;
+
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    statistics.start();
+
+    // vectors of size m
+    TVector r(A.getRows());
+    r = b - A * x;
+    TVector q(A.getRows());
+
+    // vectors of size n
+    TVector s(A.getCols());
+    Zee::multiplyTransposed(A, r, s);
+    statistics.countSpMV(2);
+    statistics.lap(phase::spmv);
+    TVector p = s;
+    statistics.lap(phase::vector_update);
+
+    auto gamma = s.dot(s);
+    statistics.countReduction();
+    statistics.lap(phase::synchronization);
+
+    std::vector<TVal> rhos;
+    rhos.push_back(std::sqrt(gamma));
+
+    for (TIdx k = 0; k < max_iterations && rhos.back() >= tol; ++k) {
+        q = A * p;
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+        auto delta = q.dot(q);
+        statistics.countReduction();
+        statistics.lap(phase::synchronization);
+        if (delta == 0) break;
+
+        auto alpha = gamma / delta;
+        Zee::axpby(alpha, p, (TVal)1, x);
+        Zee::axpby(-alpha, q, (TVal)1, r);
+        statistics.lap(phase::vector_update);
+
+        Zee::multiplyTransposed(A, r, s);
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+        auto gammaNext = s.dot(s);
+        statistics.countReduction();
+        statistics.lap(phase::synchronization);
+        rhos.push_back(std::sqrt(gammaNext));
+        statistics.addIteration(rhos.back());
+
+        Zee::axpby((TVal)1, s, gammaNext / gamma, p);
+        gamma = gammaNext;
+        statistics.lap(phase::vector_update);
+    }
+
+    statistics.finish();
+
+    return rhos;
+}
+
+/** Solve the least-squares problem \f$\min_x \| b - A x \|\f$ for a
+ * (rectangular) m x n matrix A, using CG on the normal equations.
+ * @return the norm of the residual of the normal equations before the first
+ * iteration and after each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx max_iterations,
+                        TVal tol, bool plotResiduals = false,
+                        bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solve(A, b, x, max_iterations, tol, statistics);
+
+    if (benchmark) statistics.report("CGLS");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto plot = Zee::Plotter<TVal>();
+        plot["xlabel"] = "iterations";
+        plot["ylabel"] = "$\\|A^T r\\|$";
+        plot["yscale"] = "log";
+        plot["title"] = "CGLS: residual norm of the normal equations";
+        plot.addLine(rhos, "rhos");
+        plot.plot("residual_test_cgls", true);
+    }
+
+    return rhos;
+}
+
+}  // namespace CGLS
+
+}  // namespace Zee
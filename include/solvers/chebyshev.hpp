@@ -0,0 +1,216 @@
+/*
+File: include/solvers/chebyshev.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../matrix/dense/dense.hpp"
+#include "../matrix/sparse/sparse.hpp"
+#include "dense_eigen.hpp"
+#include "preconditioners.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** Estimates the extreme eigenvalues of \f$D^{-1} A\f$, for a symmetric
+ * matrix A with a positive diagonal D, by `steps` steps of the Lanczos process
+ * for the symmetric matrix \f$D^{-1/2} A D^{-1/2}\f$. The extreme Ritz
+ * values converge first, so that a few steps give good estimates, and the
+ * largest Ritz value is a lower bound for the largest eigenvalue.
+ * @return the smallest and the largest Ritz value */
+template <typename TVal, typename TIdx>
+std::pair<double, double> lanczosBounds(
+    DSparseMatrix<TVal, TIdx>& A, const DVector<TVal, TIdx>& inverseDiagonal,
+    TIdx steps) {
+    using TVector = DVector<TVal, TIdx>;
+
+    auto n = A.getRows();
+    steps = std::max(std::min(steps, n), (TIdx)1);
+
+    TVector scaling(n);
+    for (TIdx i = 0; i < n; ++i) {
+        scaling[i] = std::sqrt(inverseDiagonal[i]);
+    }
+
+    // a fixed start vector, so that the bounds are reproducible
+    TVector v(n);
+    std::mt19937 generator(n);
+    std::uniform_real_distribution<TVal> distribution(-1, 1);
+    for (TIdx i = 0; i < n; ++i) {
+        v[i] = distribution(generator);
+    }
+    scale((TVal)1 / v.norm(), v);
+
+    TVector previous(n, 0);
+    TVector u(n);
+    TVector w(n);
+    std::vector<double> alpha;
+    std::vector<double> beta;
+    for (TIdx j = 0; j < steps; ++j) {
+        for (TIdx i = 0; i < n; ++i) {
+            u[i] = scaling[i] * v[i];
+        }
+        w = A * u;
+        for (TIdx i = 0; i < n; ++i) {
+            w[i] *= scaling[i];
+        }
+
+        alpha.push_back(v.dot(w));
+        axpby((TVal)-alpha.back(), v, (TVal)1, w);
+        if (j > 0) axpby((TVal)-beta.back(), previous, (TVal)1, w);
+
+        auto norm = w.norm();
+        if (j + 1 == steps || norm == 0) break;
+        beta.push_back(norm);
+
+        copy(v, previous);
+        scale((TVal)1 / norm, w, v);
+    }
+
+    auto k = alpha.size();
+    std::vector<double> T(k * k, 0);
+    for (std::size_t j = 0; j < k; ++j) {
+        T[j * k + j] = alpha[j];
+        if (j + 1 < k) {
+            T[j * k + j + 1] = beta[j];
+            T[(j + 1) * k + j] = beta[j];
+        }
+    }
+
+    auto theta = eigenvalues(k, T);
+    auto bounds = std::make_pair(theta[0].real(), theta[0].real());
+    for (auto value : theta) {
+        bounds.first = std::min(bounds.first, value.real());
+        bounds.second = std::max(bounds.second, value.real());
+    }
+
+    return bounds;
+}
+
+}  // namespace detail
+
+/** The Chebyshev polynomial preconditioner, and smoother, for a symmetric
+ * positive definite matrix A. Applying it runs `degree` steps of the
+ * Chebyshev iteration for Jacobi-preconditioned A on the interval
+ * \f$[\lambda_{\min}, \lambda_{\max}]\f$, which takes degree - 1 SpMVs and
+ * a few vector updates per step. Since it needs no inner products, there are
+ * no global reductions when it is applied, only the communication of the
+ * SpMVs. The result is \f$p(D^{-1} A) D^{-1} r\f$ for a fixed polynomial p,
+ * so it can be used with CG as well as GMRES.
+ *
+ * The bounds are estimated once, by a few Lanczos steps, see
+ * `lanczosBounds`. The largest eigenvalue is increased by 10 percent, since
+ * the Lanczos estimate approaches it from below. If `ratio` is positive, the
+ * interval is \f$[\lambda_{\max} / \mathrm{ratio}, \lambda_{\max}]\f$. Only
+ * the upper part of the spectrum is damped, which is what a multigrid smoother
+ * has to do. Otherwise the smallest Ritz value is taken as lower bound.
+ *
+ * The preconditioner holds a reference to A, which has to outlive it. */
+template <typename TVal, typename TIdx>
+class ChebyshevPreconditioner {
+   public:
+    ChebyshevPreconditioner(DSparseMatrix<TVal, TIdx>& A, TIdx degree,
+                            TVal ratio = 0, TIdx steps = 10)
+        : A_(&A),
+          degree_(std::max(degree, (TIdx)1)),
+          inverseDiagonal_(
+              detail::inverseDiagonal(A, "Chebyshev preconditioner")) {
+        auto bounds = detail::lanczosBounds(A, inverseDiagonal_, steps);
+        upper_ = (TVal)(1.1 * bounds.second);
+        lower_ = (ratio > 0) ? upper_ / ratio : (TVal)bounds.first;
+        lower_ = std::min(std::max(lower_, upper_ * (TVal)1e-6), upper_ / 2);
+    }
+
+    /** Computes \f$z = M^{-1} r\f$ */
+    void apply(const DVector<TVal, TIdx>& r, DVector<TVal, TIdx>& z) const {
+        iterate_(r, z, true);
+    }
+
+    /** Improves the approximate solution x of Ax = b by `degree` steps */
+    void smooth(const DVector<TVal, TIdx>& b, DVector<TVal, TIdx>& x) const {
+        iterate_(b, x, false);
+    }
+
+    /** @return the interval on which the polynomial is constructed */
+    std::pair<TVal, TVal> getBounds() const {
+        return std::make_pair(lower_, upper_);
+    }
+
+   private:
+    void iterate_(const DVector<TVal, TIdx>& b, DVector<TVal, TIdx>& x,
+                  bool zeroGuess) const {
+        JWAssert(b.size() == inverseDiagonal_.size());
+        JWAssert(x.size() == inverseDiagonal_.size());
+
+        using TVector = DVector<TVal, TIdx>;
+
+        auto n = b.size();
+        auto theta = (upper_ + lower_) / 2;
+        auto delta = (upper_ - lower_) / 2;
+        auto sigma = theta / delta;
+        auto rho = 1 / sigma;
+
+        auto r = TVector::uninitialized(n);
+        if (zeroGuess) {
+            copy(b, r);
+        } else {
+            r = b - (*A_) * x;
+        }
+
+        auto d = TVector::uninitialized(n);
+        auto w = TVector::uninitialized(n);
+        const auto* dinv = inverseDiagonal_.data();
+        auto* ds = d.data();
+        auto* rs = r.data();
+        auto* xs = x.data();
+
+        // d = D^{-1} r / theta, and x = x + d
+        detail::elementwise(n, [=](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                ds[i] = dinv[i] * rs[i] / theta;
+                xs[i] = zeroGuess ? ds[i] : xs[i] + ds[i];
+            }
+        });
+
+        for (TIdx k = 1; k < degree_; ++k) {
+            // r = r - A d
+            w = (*A_) * d;
+            axpby((TVal)-1, w, (TVal)1, r);
+
+            auto next = 1 / (2 * sigma - rho);
+            auto a = next * rho;
+            auto c = 2 * next / delta;
+            detail::elementwise(n, [=](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    ds[i] = a * ds[i] + c * dinv[i] * rs[i];
+                    xs[i] += ds[i];
+                }
+            });
+            rho = next;
+        }
+    }
+
+    DSparseMatrix<TVal, TIdx>* A_;
+    TIdx degree_;
+    DVector<TVal, TIdx> inverseDiagonal_;
+    TVal lower_ = 0;
+    TVal upper_ = 0;
+};
+
+}  // namespace Zee
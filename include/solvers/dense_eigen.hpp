@@ -0,0 +1,472 @@
+/*
+File: include/solvers/dense_eigen.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "jw.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+// Dense linear algebra for the small projected problems of the Krylov
+// methods, such as the Hessenberg matrices of GMRES. The matrices are stored
+// by columns, i.e. a(i, j) is at index j n + i, and the computations are done
+// in double precision regardless of the precision of the solver.
+
+/** The LU factorization with partial pivoting of an n x n matrix a, computed
+ * once so that it can be solved for many right-hand sides, e.g. at the
+ * coarsest level of multigrid. A zero pivot is replaced by a tiny multiple of
+ * the norm of a, as is done for inverse iteration. */
+template <typename T>
+class DenseLU {
+   public:
+    DenseLU() = default;
+
+    DenseLU(std::size_t n, std::vector<T> a)
+        : n_(n), lu_(std::move(a)), pivots_(n) {
+        double norm = 0;
+        for (auto& value : lu_) {
+            norm = std::max(norm, (double)std::abs(value));
+        }
+        auto tiny = std::max(norm, 1.0) * 1e-14;
+
+        for (std::size_t j = 0; j < n; ++j) {
+            auto pivot = j;
+            for (auto i = j + 1; i < n; ++i) {
+                if (std::abs(lu_[j * n + i]) > std::abs(lu_[j * n + pivot])) {
+                    pivot = i;
+                }
+            }
+            pivots_[j] = pivot;
+            if (pivot != j) {
+                for (auto l = j; l < n; ++l) {
+                    std::swap(lu_[l * n + j], lu_[l * n + pivot]);
+                }
+            }
+            if (std::abs(lu_[j * n + j]) == 0) lu_[j * n + j] = tiny;
+
+            // the multipliers are stored below the diagonal, and the later
+            // row interchanges are not applied to them, so that the solve
+            // interchanges and eliminates in the same order
+            for (auto i = j + 1; i < n; ++i) {
+                auto factor = lu_[j * n + i] / lu_[j * n + j];
+                lu_[j * n + i] = factor;
+                if (factor == T(0)) continue;
+                for (auto l = j + 1; l < n; ++l) {
+                    lu_[l * n + i] -= factor * lu_[l * n + j];
+                }
+            }
+        }
+    }
+
+    /** Overwrites b by the solution x of a x = b */
+    void solve(std::vector<T>& b) const {
+        JWAssert(b.size() == n_);
+
+        for (std::size_t j = 0; j < n_; ++j) {
+            if (pivots_[j] != j) std::swap(b[j], b[pivots_[j]]);
+            for (auto i = j + 1; i < n_; ++i) {
+                b[i] -= lu_[j * n_ + i] * b[j];
+            }
+        }
+
+        for (auto j = n_; j-- > 0;) {
+            auto sum = b[j];
+            for (auto l = j + 1; l < n_; ++l) {
+                sum -= lu_[l * n_ + j] * b[l];
+            }
+            b[j] = sum / lu_[j * n_ + j];
+        }
+    }
+
+    std::size_t size() const { return n_; }
+
+   private:
+    std::size_t n_ = 0;
+    std::vector<T> lu_;
+    std::vector<std::size_t> pivots_;
+};
+
+/** Solves a x = b for the n x n matrix a by Gaussian elimination with
+ * partial pivoting, see `DenseLU` */
+template <typename T>
+std::vector<T> solveDense(std::size_t n, std::vector<T> a, std::vector<T> b) {
+    DenseLU<T>(n, std::move(a)).solve(b);
+    return b;
+}
+
+/** @return the eigenvalues of the general real n x n matrix a. The matrix is
+ * reduced to upper Hessenberg form by stabilized elimination, after which
+ * the eigenvalues are found by the implicitly double-shifted QR algorithm.
+ * Complex eigenvalues come in conjugate pairs. */
+inline std::vector<std::complex<double>> eigenvalues(std::size_t n,
+                                                     std::vector<double> a) {
+    // one-based access, which keeps the classic formulation readable
+    auto at = [&](std::size_t i, std::size_t j) -> double& {
+        return a[(j - 1) * n + (i - 1)];
+    };
+
+    // reduction to Hessenberg form
+    for (std::size_t m = 2; m < n; ++m) {
+        double x = 0;
+        auto i = m;
+        for (auto j = m; j <= n; ++j) {
+            if (std::abs(at(j, m - 1)) > std::abs(x)) {
+                x = at(j, m - 1);
+                i = j;
+            }
+        }
+        if (i != m) {
+            for (auto j = m - 1; j <= n; ++j) std::swap(at(i, j), at(m, j));
+            for (std::size_t j = 1; j <= n; ++j) std::swap(at(j, i), at(j, m));
+        }
+        if (x != 0) {
+            for (i = m + 1; i <= n; ++i) {
+                auto y = at(i, m - 1);
+                if (y == 0) continue;
+                y /= x;
+                at(i, m - 1) = 0;
+                for (auto j = m; j <= n; ++j) at(i, j) -= y * at(m, j);
+                for (std::size_t j = 1; j <= n; ++j) at(j, m) += y * at(j, i);
+            }
+        }
+    }
+
+    std::vector<std::complex<double>> result(n);
+    auto store = [&](std::size_t i, double re, double im) {
+        result[i - 1] = std::complex<double>(re, im);
+    };
+    auto sign = [](double magnitude, double direction) {
+        return direction >= 0 ? std::abs(magnitude) : -std::abs(magnitude);
+    };
+
+    double anorm = 0;
+    for (std::size_t i = 1; i <= n; ++i) {
+        for (auto j = std::max(i - 1, (std::size_t)1); j <= n; ++j) {
+            anorm += std::abs(at(i, j));
+        }
+    }
+
+    auto nn = n;
+    double t = 0;
+    double p = 0, q = 0, r = 0, s = 0, w = 0, x = 0, y = 0, z = 0;
+    while (nn >= 1) {
+        std::size_t its = 0;
+        std::size_t l = 0;
+        do {
+            // look for a single small subdiagonal element
+            for (l = nn; l >= 2; --l) {
+                s = std::abs(at(l - 1, l - 1)) + std::abs(at(l, l));
+                if (s == 0) s = anorm;
+                if (std::abs(at(l, l - 1)) + s == s) {
+                    at(l, l - 1) = 0;
+                    break;
+                }
+            }
+
+            x = at(nn, nn);
+            if (l == nn) {
+                // one root found
+                store(nn, x + t, 0);
+                nn--;
+            } else {
+                y = at(nn - 1, nn - 1);
+                w = at(nn, nn - 1) * at(nn - 1, nn);
+                if (l == nn - 1) {
+                    // two roots found
+                    p = 0.5 * (y - x);
+                    q = p * p + w;
+                    z = std::sqrt(std::abs(q));
+                    x += t;
+                    if (q >= 0) {
+                        z = p + sign(z, p);
+                        store(nn - 1, x + z, 0);
+                        store(nn, (z != 0) ? x - w / z : x + z, 0);
+                    } else {
+                        store(nn - 1, x + p, -z);
+                        store(nn, x + p, z);
+                    }
+                    nn -= 2;
+                } else {
+                    if (its == 60) {
+                        JWLogError << "Eigenvalues: no convergence of the QR "
+                                      "algorithm"
+                                   << endLog;
+                        for (std::size_t i = 1; i <= nn; ++i) {
+                            store(i, at(i, i) + t, 0);
+                        }
+                        return result;
+                    }
+                    if (its == 10 || its == 20) {
+                        // exceptional shift
+                        t += x;
+                        for (std::size_t i = 1; i <= nn; ++i) at(i, i) -= x;
+                        s = std::abs(at(nn, nn - 1)) +
+                            std::abs(at(nn - 1, nn - 2));
+                        y = x = 0.75 * s;
+                        w = -0.4375 * s * s;
+                    }
+                    ++its;
+
+                    // look for two consecutive small subdiagonal elements
+                    auto m = nn - 2;
+                    for (;; --m) {
+                        z = at(m, m);
+                        r = x - z;
+                        s = y - z;
+                        p = (r * s - w) / at(m + 1, m) + at(m, m + 1);
+                        q = at(m + 1, m + 1) - z - r - s;
+                        r = at(m + 2, m + 1);
+                        s = std::abs(p) + std::abs(q) + std::abs(r);
+                        p /= s;
+                        q /= s;
+                        r /= s;
+                        if (m == l) break;
+                        auto u = std::abs(at(m, m - 1)) *
+                                 (std::abs(q) + std::abs(r));
+                        auto v = std::abs(p) *
+                                 (std::abs(at(m - 1, m - 1)) + std::abs(z) +
+                                  std::abs(at(m + 1, m + 1)));
+                        if (u + v == v) break;
+                    }
+                    for (auto i = m + 2; i <= nn; ++i) {
+                        at(i, i - 2) = 0;
+                        if (i != m + 2) at(i, i - 3) = 0;
+                    }
+
+                    // the double QR step on rows l to nn, columns m to nn
+                    for (auto k = m; k <= nn - 1; ++k) {
+                        if (k != m) {
+                            p = at(k, k - 1);
+                            q = at(k + 1, k - 1);
+                            r = (k != nn - 1) ? at(k + 2, k - 1) : 0;
+                            x = std::abs(p) + std::abs(q) + std::abs(r);
+                            if (x != 0) {
+                                p /= x;
+                                q /= x;
+                                r /= x;
+                            }
+                        }
+                        s = sign(std::sqrt(p * p + q * q + r * r), p);
+                        if (s == 0) continue;
+
+                        if (k == m) {
+                            if (l != m) at(k, k - 1) = -at(k, k - 1);
+                        } else {
+                            at(k, k - 1) = -s * x;
+                        }
+                        p += s;
+                        x = p / s;
+                        y = q / s;
+                        z = r / s;
+                        q /= p;
+                        r /= p;
+                        for (auto j = k; j <= nn; ++j) {
+                            p = at(k, j) + q * at(k + 1, j);
+                            if (k != nn - 1) {
+                                p += r * at(k + 2, j);
+                                at(k + 2, j) -= p * z;
+                            }
+                            at(k + 1, j) -= p * y;
+                            at(k, j) -= p * x;
+                        }
+                        auto last = std::min(nn, k + 3);
+                        for (auto i = l; i <= last; ++i) {
+                            p = x * at(i, k) + y * at(i, k + 1);
+                            if (k != nn - 1) {
+                                p += z * at(i, k + 2);
+                                at(i, k + 2) -= p * r;
+                            }
+                            at(i, k + 1) -= p * q;
+                            at(i, k) -= p;
+                        }
+                    }
+                }
+            }
+        } while (nn >= 1 && l + 1 < nn);
+    }
+
+    return result;
+}
+
+/** @return a (complex) eigenvector of the real n x n matrix a for the
+ * eigenvalue theta, with unit norm, computed by inverse iteration */
+inline std::vector<std::complex<double>> eigenvector(
+    std::size_t n, const std::vector<double>& a, std::complex<double> theta) {
+    using TComplex = std::complex<double>;
+
+    std::vector<TComplex> shifted(a.begin(), a.end());
+    for (std::size_t i = 0; i < n; ++i) {
+        shifted[i * n + i] -= theta;
+    }
+
+    std::vector<TComplex> x(n, TComplex(1, 0));
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        x = solveDense(n, shifted, x);
+        double norm = 0;
+        for (auto& value : x) {
+            norm = std::hypot(norm, std::abs(value));
+        }
+        for (auto& value : x) {
+            value /= norm;
+        }
+    }
+
+    return x;
+}
+
+/** Computes the eigenvalues and eigenvectors of the symmetric n x n matrix a
+ * by the cyclic Jacobi method, which gives orthonormal eigenvectors also for
+ * (nearly) multiple eigenvalues.
+ * @return the eigenvalues, which are not sorted, and the eigenvectors, stored
+ * by columns in the same order */
+inline std::pair<std::vector<double>, std::vector<double>> symmetricEigen(
+    std::size_t n, std::vector<double> a) {
+    std::vector<double> V(n * n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        V[i * n + i] = 1;
+    }
+
+    double norm = 0;
+    for (auto value : a) {
+        norm = std::hypot(norm, value);
+    }
+
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = 0;
+        for (std::size_t q = 0; q < n; ++q) {
+            for (std::size_t p = 0; p < q; ++p) {
+                off = std::hypot(off, a[q * n + p]);
+            }
+        }
+        if (off <= 1e-15 * norm) break;
+
+        for (std::size_t q = 0; q < n; ++q) {
+            for (std::size_t p = 0; p < q; ++p) {
+                auto apq = a[q * n + p];
+                if (apq == 0) continue;
+
+                // the rotation that eliminates a(p, q)
+                auto theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                auto t = ((theta < 0) ? -1.0 : 1.0) /
+                         (std::abs(theta) + std::sqrt(theta * theta + 1));
+                auto c = 1 / std::sqrt(t * t + 1);
+                auto s = t * c;
+
+                auto rotate = [c, s](double& x, double& y) {
+                    auto rotated = c * x - s * y;
+                    y = s * x + c * y;
+                    x = rotated;
+                };
+                for (std::size_t k = 0; k < n; ++k) {
+                    rotate(a[p * n + k], a[q * n + k]);
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    rotate(a[k * n + p], a[k * n + q]);
+                }
+                for (std::size_t k = 0; k < n; ++k) {
+                    rotate(V[p * n + k], V[q * n + k]);
+                }
+            }
+        }
+    }
+
+    std::vector<double> values(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values[i] = a[i * n + i];
+    }
+
+    return std::make_pair(values, V);
+}
+
+/** @return real vectors that span the eigenvectors of the n x n matrix a for
+ * its first k eigenvalues in the order given by `before`. A complex conjugate
+ * pair is represented by the real and imaginary parts of an eigenvector, so
+ * that k + 1 vectors are returned if the k-th eigenvalue is part of a pair,
+ * as long as this stays below `limit`. */
+template <typename TCompare>
+std::vector<std::vector<double>> eigenvectorBasis(std::size_t n,
+                                                  const std::vector<double>& a,
+                                                  std::size_t k,
+                                                  std::size_t limit,
+                                                  TCompare before) {
+    auto theta = eigenvalues(n, a);
+    std::sort(theta.begin(), theta.end(), before);
+
+    std::vector<std::vector<double>> vectors;
+    for (auto value : theta) {
+        if (vectors.size() >= k) break;
+        if (value.imag() < 0) continue;
+        if (value.imag() > 0 && vectors.size() + 2 > limit) break;
+
+        auto x = eigenvector(n, a, value);
+        std::vector<double> re(n);
+        std::vector<double> im(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            re[i] = x[i].real();
+            im[i] = x[i].imag();
+        }
+        vectors.push_back(re);
+        if (value.imag() > 0) vectors.push_back(im);
+    }
+
+    return vectors;
+}
+
+/** Appends the vectors, of length rows, to the orthonormal columns Q by
+ * modified Gram-Schmidt with reorthogonalization. Vectors that are
+ * (numerically) dependent on the previous columns are dropped.
+ * @return the number of columns that were appended */
+inline std::size_t orthonormalize(std::size_t rows,
+                                  std::vector<std::vector<double>> vectors,
+                                  std::vector<double>& Q) {
+    std::size_t added = 0;
+    for (auto& u : vectors) {
+        double original = 0;
+        for (auto value : u) original = std::hypot(original, value);
+
+        auto columns = Q.size() / rows;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (std::size_t j = 0; j < columns; ++j) {
+                double dot = 0;
+                for (std::size_t i = 0; i < rows; ++i) {
+                    dot += Q[j * rows + i] * u[i];
+                }
+                for (std::size_t i = 0; i < rows; ++i) {
+                    u[i] -= dot * Q[j * rows + i];
+                }
+            }
+        }
+
+        double norm = 0;
+        for (auto value : u) norm = std::hypot(norm, value);
+        if (norm <= 1e-10 * original || norm == 0) continue;
+
+        for (auto value : u) Q.push_back(value / norm);
+        added++;
+    }
+
+    return added;
+}
+
+}  // namespace detail
+
+}  // namespace Zee
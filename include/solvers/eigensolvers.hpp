@@ -0,0 +1,415 @@
+/*
+File: include/solvers/eigensolvers.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../matrix/dense/block_kernels.hpp"
+#include "../matrix/dense/dense.hpp"
+#include "../matrix/dense/vector_pool.hpp"
+#include "../matrix/sparse/sparse.hpp"
+#include "dense_eigen.hpp"
+
+namespace Zee {
+
+/** Which eigenvalues an eigensolver computes */
+enum class eigen_target {
+    /** The largest eigenvalues, or those of largest real part */
+    largest,
+    /** The smallest eigenvalues, or those of smallest real part */
+    smallest,
+    /** The eigenvalues of largest magnitude */
+    largest_magnitude
+};
+
+/** Approximate eigenpairs, as computed by `Lanczos::solve` and
+ * `Arnoldi::solve`. The residual is the estimate of
+ * \f$\| A x - \theta x \|\f$ for the eigenvector x of unit norm. */
+template <typename TValue, typename TVal, typename TIdx>
+struct EigenPairs {
+    std::vector<TValue> values;
+    std::vector<DVector<TVal, TIdx>> vectors;
+    std::vector<double> residuals;
+    TIdx restarts = 0;
+    TIdx spmvs = 0;
+    bool converged = false;
+};
+
+namespace detail {
+
+/** The Ritz values of the projected matrix of a cycle, ordered by the target
+ * with every complex conjugate pair kept together, the last components of
+ * their (unit) eigenvectors, and the real coefficients of the leading
+ * eigenvectors. A pair is represented by the real and imaginary parts of its
+ * eigenvector. */
+struct RitzDecomposition {
+    std::vector<std::complex<double>> values;
+    std::vector<double> lastComponents;
+    std::vector<std::vector<double>> vectors;
+};
+
+/** @return the Ritz decomposition of the symmetric part of the m x m matrix
+ * H, with eigenvectors for the first `count` values */
+inline RitzDecomposition symmetricRitz(std::size_t m,
+                                       const std::vector<double>& H,
+                                       std::size_t count, eigen_target target) {
+    std::vector<double> T(m * m);
+    for (std::size_t j = 0; j < m; ++j) {
+        for (std::size_t i = 0; i < m; ++i) {
+            T[j * m + i] = (H[j * m + i] + H[i * m + j]) / 2;
+        }
+    }
+    auto eigen = symmetricEigen(m, T);
+    auto& theta = eigen.first;
+    auto& Y = eigen.second;
+
+    std::vector<std::size_t> order(m);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        switch (target) {
+            case eigen_target::smallest:
+                return theta[a] < theta[b];
+            case eigen_target::largest_magnitude:
+                return std::abs(theta[a]) > std::abs(theta[b]);
+            default:
+                return theta[a] > theta[b];
+        }
+    });
+
+    RitzDecomposition ritz;
+    for (auto l : order) {
+        ritz.values.push_back(theta[l]);
+        ritz.lastComponents.push_back(std::abs(Y[l * m + m - 1]));
+        if (ritz.vectors.size() < count) {
+            ritz.vectors.emplace_back(Y.begin() + l * m,
+                                      Y.begin() + (l + 1) * m);
+        }
+    }
+
+    return ritz;
+}
+
+/** @return the Ritz decomposition of the general m x m matrix H, with
+ * eigenvectors for the first `count` values, or count + 1 to keep a complex
+ * conjugate pair together */
+inline RitzDecomposition generalRitz(std::size_t m,
+                                     const std::vector<double>& H,
+                                     std::size_t count, eigen_target target) {
+    using TComplex = std::complex<double>;
+
+    auto theta = eigenvalues(m, H);
+    std::sort(theta.begin(), theta.end(), [&](TComplex a, TComplex b) {
+        switch (target) {
+            case eigen_target::smallest:
+                return a.real() < b.real();
+            case eigen_target::largest_magnitude:
+                return std::abs(a) > std::abs(b);
+            default:
+                return a.real() > b.real();
+        }
+    });
+
+    RitzDecomposition ritz;
+    for (auto value : theta) {
+        if (value.imag() < 0) continue;
+
+        auto wanted = ritz.vectors.size() < count;
+        std::vector<TComplex> x;
+        if (wanted || value.imag() > 0) x = eigenvector(m, H, value);
+
+        ritz.values.push_back(value);
+        if (value.imag() > 0) ritz.values.push_back(std::conj(value));
+
+        auto last = wanted ? std::abs(x[m - 1]) : 0.0;
+        if (value.imag() > 0) last = std::abs(x[m - 1]);
+        ritz.lastComponents.push_back(last);
+        if (value.imag() > 0) ritz.lastComponents.push_back(last);
+
+        if (!wanted) continue;
+        std::vector<double> re(m);
+        std::vector<double> im(m);
+        for (std::size_t i = 0; i < m; ++i) {
+            re[i] = x[i].real();
+            im[i] = x[i].imag();
+        }
+        ritz.vectors.push_back(re);
+        if (value.imag() > 0) ritz.vectors.push_back(im);
+    }
+
+    return ritz;
+}
+
+/** @return the eigenvalue as a real number, or as a complex number */
+template <typename TValue>
+TValue eigenvalueAs(std::complex<double> value);
+
+template <>
+inline double eigenvalueAs<double>(std::complex<double> value) {
+    return value.real();
+}
+
+template <>
+inline std::complex<double> eigenvalueAs<std::complex<double>>(
+    std::complex<double> value) {
+    return value;
+}
+
+/** The thick-restart Arnoldi process for the k eigenpairs of A given by the
+ * target, with a basis of at most m vectors. At a restart, the basis is
+ * reduced to the Ritz vectors of the Ritz values closest to the target,
+ * together with the last basis vector, which keeps an Arnoldi relation
+ * \f$A V_j = V_{j + 1} \bar{H}_j\f$ in which the leading block of H is full.
+ * Restarting with the Ritz vectors of the k + (m - k) / 2 wanted values is
+ * equivalent to implicit restarting with the unwanted Ritz values as exact
+ * shifts.
+ *
+ * The basis is extended by the distributed SpMV, and is orthogonalized by
+ * classical Gram-Schmidt with reorthogonalization, in which the inner
+ * products with the basis form a single reduction. */
+template <typename TValue, typename TVal, typename TIdx, class TRitz>
+EigenPairs<TValue, TVal, TIdx> thickRestart(DSparseMatrix<TVal, TIdx>& A,
+                                            TIdx k, eigen_target target,
+                                            TIdx basis_size,
+                                            TIdx max_restarts, double tol,
+                                            TRitz ritz) {
+    JWAssert(A.getRows() == A.getCols());
+
+    using TVector = DVector<TVal, TIdx>;
+
+    auto n = A.getRows();
+    auto m = (std::size_t)std::min(basis_size, n);
+    k = std::max(std::min(k, (TIdx)m), (TIdx)1);
+    auto rows = m + 1;
+
+    // keep more vectors than wanted, but leave room for an Arnoldi step, also
+    // when the last kept value is part of a complex pair
+    auto keep = std::min((std::size_t)k + (m - k) / 2,
+                         (m > 2) ? m - 2 : (std::size_t)1);
+    keep = std::max(keep, (std::size_t)1);
+
+    auto& pool = VectorPool<TVal>::global();
+    auto basis = pool.acquire((std::size_t)n * rows);
+    std::vector<const TVal*> V(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        V[i] = basis.data() + i * n;
+    }
+
+    // a fixed start vector, so that the results are reproducible
+    TVector v(n);
+    std::mt19937 generator(n);
+    std::uniform_real_distribution<TVal> distribution(-1, 1);
+    for (TIdx i = 0; i < n; ++i) {
+        v[i] = distribution(generator);
+    }
+    scale((TVal)1 / v.norm(), v);
+    std::copy(v.data(), v.data() + n, basis.begin());
+
+    TVector w(n);
+    std::vector<TVal> h(rows);
+    std::vector<TVal> correction(rows);
+    std::vector<double> Hbar(rows * m, 0);
+
+    EigenPairs<TValue, TVal, TIdx> result;
+
+    std::size_t start = 0;
+    while (true) {
+        std::size_t columns = start;
+        auto invariant = false;
+        for (auto i = start; i < m; ++i) {
+            std::copy(V[i], V[i] + n, v.data());
+            w = A * v;
+            result.spmvs++;
+
+            // CGS2
+            detail::multiDot<TVal>(n, V.data(), i + 1, w.data(), h.data());
+            detail::multiAxpy<TVal>(n, (TVal)-1, V.data(), i + 1, h.data(),
+                                    w.data());
+            detail::multiDot<TVal>(n, V.data(), i + 1, w.data(),
+                                   correction.data());
+            detail::multiAxpy<TVal>(n, (TVal)-1, V.data(), i + 1,
+                                    correction.data(), w.data());
+            for (std::size_t l = 0; l <= i; ++l) {
+                Hbar[i * rows + l] = h[l] + correction[l];
+            }
+            auto norm = w.norm();
+            Hbar[i * rows + i + 1] = norm;
+            columns = i + 1;
+
+            // the basis spans an invariant subspace
+            if (norm == 0) {
+                invariant = true;
+                break;
+            }
+
+            scale((TVal)1 / norm, w);
+            std::copy(w.data(), w.data() + n, basis.begin() + (i + 1) * n);
+        }
+
+        std::vector<double> H(columns * columns);
+        for (std::size_t j = 0; j < columns; ++j) {
+            for (std::size_t i = 0; i < columns; ++i) {
+                H[j * columns + i] = Hbar[j * rows + i];
+            }
+        }
+        auto beta = Hbar[(columns - 1) * rows + columns];
+
+        auto decomposition =
+            ritz(columns, H, std::max((std::size_t)k, keep), target);
+
+        std::size_t wanted = std::min((std::size_t)k, columns);
+        if (wanted < decomposition.values.size() &&
+            decomposition.values[wanted - 1].imag() > 0) {
+            wanted++;
+        }
+        auto converged = true;
+        for (std::size_t l = 0; l < wanted; ++l) {
+            auto residual = beta * decomposition.lastComponents[l];
+            if (residual > tol * std::abs(decomposition.values[l])) {
+                converged = false;
+            }
+        }
+
+        if (converged || invariant || columns < m ||
+            result.restarts >= max_restarts) {
+            result.converged = converged;
+
+            std::vector<TVal> coefficients(columns);
+            for (std::size_t l = 0; l < wanted; ++l) {
+                result.values.push_back(
+                    detail::eigenvalueAs<TValue>(decomposition.values[l]));
+                result.residuals.push_back(beta *
+                                           decomposition.lastComponents[l]);
+
+                auto& y = decomposition.vectors[l];
+                std::copy(y.begin(), y.end(), coefficients.begin());
+                TVector x(n);
+                detail::multiAxpy<TVal>(n, (TVal)1, V.data(), columns,
+                                        coefficients.data(), x.data());
+                result.vectors.push_back(std::move(x));
+            }
+            break;
+        }
+
+        // the kept basis Y, with orthonormal columns of length m
+        auto& vectors = decomposition.vectors;
+        auto count = keep;
+        if (count < vectors.size() &&
+            decomposition.values[count - 1].imag() > 0) {
+            count++;
+        }
+        vectors.resize(std::min(count, vectors.size()));
+        std::vector<double> Y;
+        auto kept = orthonormalize(m, vectors, Y);
+        if (kept == 0) break;
+
+        // the projected matrix Y^T H Y, and the last row beta e_m^T Y
+        std::vector<double> restarted(rows * m, 0);
+        for (std::size_t j = 0; j < kept; ++j) {
+            std::vector<double> column(m, 0);
+            for (std::size_t l = 0; l < m; ++l) {
+                for (std::size_t i = 0; i < m; ++i) {
+                    column[i] += H[l * m + i] * Y[j * m + l];
+                }
+            }
+            for (std::size_t i = 0; i < kept; ++i) {
+                double sum = 0;
+                for (std::size_t l = 0; l < m; ++l) {
+                    sum += Y[i * m + l] * column[l];
+                }
+                restarted[j * rows + i] = sum;
+            }
+            restarted[j * rows + kept] = beta * Y[j * m + m - 1];
+        }
+        Hbar = restarted;
+
+        // the new basis [V Y, v_{m + 1}], in place
+        auto kept_basis = pool.acquire((std::size_t)n * (kept + 1));
+        std::fill(kept_basis.begin(), kept_basis.end(), (TVal)0);
+        std::vector<TVal> coefficients(m);
+        for (std::size_t j = 0; j < kept; ++j) {
+            for (std::size_t l = 0; l < m; ++l) {
+                coefficients[l] = (TVal)Y[j * m + l];
+            }
+            detail::multiAxpy<TVal>(n, (TVal)1, V.data(), m,
+                                    coefficients.data(),
+                                    kept_basis.data() + j * n);
+        }
+        std::copy(V[m], V[m] + n, kept_basis.begin() + kept * n);
+        std::copy(kept_basis.begin(), kept_basis.end(), basis.begin());
+        pool.release(std::move(kept_basis));
+
+        start = kept;
+        result.restarts++;
+    }
+
+    pool.release(std::move(basis));
+
+    return result;
+}
+
+}  // namespace detail
+
+namespace Lanczos {
+
+/** Computes k eigenpairs of the symmetric matrix A at one end of the
+ * spectrum, by the thick-restart Lanczos method with a basis of at most
+ * `basis_size` vectors. The basis is kept orthogonal by full
+ * reorthogonalization, and the projected matrix is symmetric, so that the Ritz
+ * values are real and the Ritz vectors orthogonal. A Ritz pair has converged
+ * when its residual is below tol times the magnitude of the Ritz value.
+ *
+ * The extreme eigenvalues converge fastest, so that a few restarts give
+ * spectral bounds, or the lowest modes of a structure. */
+template <typename TVal, typename TIdx>
+EigenPairs<double, TVal, TIdx> solve(DSparseMatrix<TVal, TIdx>& A, TIdx k,
+                                     eigen_target target, TIdx basis_size,
+                                     TIdx max_restarts, double tol) {
+    JWLogInfo << "Computing " << k << " eigenpairs of a matrix of size "
+              << A.getRows() << " x " << A.getCols() << " with "
+              << A.nonZeros() << " non-zeros (Lanczos)" << endLog;
+
+    return detail::thickRestart<double>(A, k, target, basis_size,
+                                        max_restarts, tol,
+                                        detail::symmetricRitz);
+}
+
+}  // namespace Lanczos
+
+namespace Arnoldi {
+
+/** Computes k eigenpairs of the general matrix A at one end of the spectrum,
+ * by the Arnoldi method with thick restarts, see `Lanczos::solve`. Complex
+ * eigenvalues come in conjugate pairs, so k + 1 values are returned if the
+ * k-th value is part of a pair. The eigenvectors of a pair are represented by
+ * the real and imaginary parts of a complex eigenvector of unit norm. */
+template <typename TVal, typename TIdx>
+EigenPairs<std::complex<double>, TVal, TIdx> solve(
+    DSparseMatrix<TVal, TIdx>& A, TIdx k, eigen_target target,
+    TIdx basis_size, TIdx max_restarts, double tol) {
+    JWLogInfo << "Computing " << k << " eigenpairs of a matrix of size "
+              << A.getRows() << " x " << A.getCols() << " with "
+              << A.nonZeros() << " non-zeros (Arnoldi)" << endLog;
+
+    return detail::thickRestart<std::complex<double>>(
+        A, k, target, basis_size, max_restarts, tol, detail::generalRitz);
+}
+
+}  // namespace Arnoldi
+
+}  // namespace Zee
@@ -0,0 +1,443 @@
+/*
+File: include/solvers/gcro_dr.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "dense_eigen.hpp"
+#include "hessenberg.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** Computes the coefficients P, an orthonormal m x k matrix stored by
+ * columns, of the subspace that GCRO-DR recycles after a cycle with
+ * \f$A \hat{V} = \hat{W} G\f$, where G is (m + 1) x m and \f$\hat{W}\f$ has
+ * orthonormal columns. The columns of P span the harmonic Ritz vectors of the
+ * k harmonic Ritz values of smallest magnitude, which solve
+ * \f[ G^T G z = \theta G^T \hat{W}^T \hat{V} z. \f]
+ * These are found as the eigenvalues \f$1 / \theta\f$ of largest magnitude of
+ * \f$(G^T G)^{-1} G^T \hat{W}^T \hat{V}\f$.
+ * @return the number of columns of P */
+inline std::size_t recycledRitzBasis(std::size_t m, std::size_t k,
+                                     const std::vector<double>& G,
+                                     const std::vector<double>& WV,
+                                     std::vector<double>& P) {
+    auto rows = m + 1;
+
+    std::vector<double> gram(m * m);
+    std::vector<double> product(m * m);
+    for (std::size_t j = 0; j < m; ++j) {
+        for (std::size_t i = 0; i < m; ++i) {
+            double sum = 0;
+            double mixed = 0;
+            for (std::size_t l = 0; l < rows; ++l) {
+                sum += G[i * rows + l] * G[j * rows + l];
+                mixed += G[i * rows + l] * WV[j * rows + l];
+            }
+            gram[j * m + i] = sum;
+            product[j * m + i] = mixed;
+        }
+    }
+
+    std::vector<double> S(m * m);
+    std::vector<double> column(m);
+    for (std::size_t j = 0; j < m; ++j) {
+        std::copy(product.begin() + j * m, product.begin() + (j + 1) * m,
+                  column.begin());
+        auto solution = solveDense(m, gram, column);
+        std::copy(solution.begin(), solution.end(), S.begin() + j * m);
+    }
+
+    auto vectors = eigenvectorBasis(
+        m, S, k, m - 1, [](std::complex<double> a, std::complex<double> b) {
+            return std::abs(a) > std::abs(b);
+        });
+
+    P.clear();
+    return orthonormalize(m, vectors, P);
+}
+
+}  // namespace detail
+
+namespace GMRES {
+
+/** The subspace that GCRO-DR recycles between solves: a basis U, and
+ * C = A U with orthonormal columns. The subspace is filled by the first solve,
+ * and is updated at the end of every cycle of later solves. */
+template <typename TVal = default_scalar_type,
+          typename TIdx = default_index_type>
+class RecycledSubspace {
+   public:
+    using TVector = Zee::DVector<TVal, TIdx>;
+
+    /** A subspace that recycles (at most) k vectors */
+    explicit RecycledSubspace(TIdx k) : k_(k) {}
+
+    /** @return the number of vectors that is recycled */
+    TIdx getDimension() const { return k_; }
+
+    /** @return the number of vectors currently in the subspace */
+    std::size_t size() const { return U_.size(); }
+
+    /** Discard the subspace, e.g. when the next system is unrelated */
+    void clear() {
+        U_.clear();
+        C_.clear();
+    }
+
+    std::vector<TVector>& getU() { return U_; }
+    std::vector<TVector>& getC() { return C_; }
+
+   private:
+    TIdx k_ = 0;
+    std::vector<TVector> U_;
+    std::vector<TVector> C_;
+};
+
+/** Solve Ax = b using GCRO-DR(m, k), with m = inner_iterations, which
+ * recycles a subspace of dimension k from one solve to the next.
+ *
+ * For a sequence of systems whose matrices change slowly, e.g. after
+ * `updateValues`, the harmonic Ritz vectors of the smallest harmonic Ritz
+ * values remain good approximations of the eigenvectors that slow down
+ * GMRES. The subspace U is kept in `space`. At the start of a solve, C = A U
+ * is recomputed for the current values of A and orthonormalized (k SpMVs),
+ * and every cycle first solves for the component of the residual in the range
+ * of C, and then runs m - k Arnoldi steps for the projected operator
+ * \f$(I - C C^T) A\f$. Within a solve this is GMRES with deflated restarting,
+ * and the first solve builds the subspace from harmonic Ritz vectors of a
+ * GMRES(m) cycle.
+ *
+ * The solve is recorded in `statistics`, as for `solve`. Recomputing C and
+ * updating the subspace count as orthogonalization.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveRecycled(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                RecycledSubspace<TVal, TIdx>& space,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (recycling " << space.size() << " of "
+              << space.getDimension() << " vectors)" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+    auto m = (std::size_t)std::min(n, inner_iterations);
+    auto rows = m + 1;
+
+    statistics.start();
+
+    // at least two Arnoldi steps per cycle, also for a complex pair
+    auto kmax = (m > 2) ? std::min((std::size_t)space.getDimension(), m - 2)
+                        : (std::size_t)0;
+
+    auto& U = space.getU();
+    auto& C = space.getC();
+    if (U.size() > kmax) U.erase(U.begin() + kmax, U.end());
+
+    // C = A U, and U = U R^{-1} for C = QR
+    C.clear();
+    for (auto& u : U) {
+        C.emplace_back(n);
+        C.back() = A * u;
+    }
+    statistics.countSpMV(U.size());
+    statistics.lap(phase::spmv);
+    auto R = Zee::tsqr(C);
+    auto k = U.size();
+    statistics.countReduction(k * (k + 1) / 2);
+    for (std::size_t j = 0; j < k; ++j) {
+        if (R[j * k + j] == 0) {
+            space.clear();
+            break;
+        }
+        for (std::size_t l = 0; l < j; ++l) {
+            Zee::axpby(-R[j * k + l], U[l], (TVal)1, U[j]);
+        }
+        Zee::scale((TVal)1 / R[j * k + j], U[j]);
+    }
+    statistics.lap(phase::orthogonalization);
+
+    TVector r(n);
+    auto beta = residual(A, x, b, r);
+    statistics.countSpMV();
+    statistics.countReduction();
+    statistics.lap(phase::spmv);
+
+    // the Arnoldi basis, as a single contiguous block of m + 1 columns
+    auto& pool = VectorPool<TVal>::global();
+    auto basis = pool.acquire(n * rows);
+
+    TVector v(n);
+    TVector w(n);
+
+    // the projected matrix G of A [U V] = [C V] G, stored by columns
+    std::vector<TVal> G(rows * m);
+    std::vector<TVal> h(rows);
+    std::vector<TVal> correction(rows);
+    Zee::detail::GivensLeastSquares<TVal> leastSquares(m);
+    statistics.lap(phase::other);
+
+    auto finished = false;
+    for (TIdx run = 0; run < outer_iterations && !finished; ++run) {
+        if (run > 0) statistics.countRestart();
+
+        k = U.size();
+        auto steps = m - k;
+
+        // the columns of [U V] and [C V]
+        std::vector<const TVal*> Vhat;
+        std::vector<const TVal*> What;
+        for (std::size_t i = 0; i < k; ++i) {
+            Vhat.push_back(U[i].data());
+            What.push_back(C[i].data());
+        }
+        for (std::size_t i = 0; i <= steps; ++i) {
+            if (i < steps) Vhat.push_back(basis.data() + i * n);
+            What.push_back(basis.data() + i * n);
+        }
+
+        // x = x + U C^T r, and r = (I - C C^T) r
+        if (k > 0) {
+            Zee::detail::multiDot<TVal>(n, What.data(), k, r.data(), h.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)1, Vhat.data(), k, h.data(),
+                                         x.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)-1, What.data(), k,
+                                         h.data(), r.data());
+            statistics.countReduction(k);
+            statistics.lap(phase::orthogonalization);
+            beta = r.norm();
+            statistics.countReduction();
+            statistics.lap(phase::synchronization);
+        }
+        if (beta < tol) break;
+
+        Zee::scale((TVal)1 / beta, r, v);
+        std::copy(v.data(), v.data() + n, basis.begin());
+        statistics.lap(phase::vector_update);
+
+        // the leading block of G is the identity
+        std::fill(G.begin(), G.end(), (TVal)0);
+        std::vector<TVal> g(rows, 0);
+        g[k] = beta;
+        leastSquares.reset(g.data(), k + 1);
+        for (std::size_t i = 0; i < k; ++i) {
+            G[i * rows + i] = 1;
+            leastSquares.addColumn(G.data() + i * rows, i + 1);
+        }
+        statistics.lap(phase::other);
+
+        std::size_t columns = k;
+        for (std::size_t j = 0; j < steps; ++j) {
+            w = A * v;
+            statistics.countSpMV();
+            statistics.lap(phase::spmv);
+
+            // CGS2 against C and the Arnoldi basis
+            auto count = k + j + 1;
+            Zee::detail::multiDot<TVal>(n, What.data(), count, w.data(),
+                                        h.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)-1, What.data(), count,
+                                         h.data(), w.data());
+            Zee::detail::multiDot<TVal>(n, What.data(), count, w.data(),
+                                        correction.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)-1, What.data(), count,
+                                         correction.data(), w.data());
+            for (std::size_t l = 0; l < count; ++l) {
+                h[l] += correction[l];
+            }
+            h[count] = w.norm();
+            statistics.countReduction(count);
+            statistics.countReduction(count);
+            statistics.countReduction();
+            statistics.lap(phase::orthogonalization);
+            std::copy(h.begin(), h.begin() + count + 1,
+                      G.begin() + (k + j) * rows);
+
+            auto rho = leastSquares.addColumn(h.data(), count + 1);
+            statistics.addIteration(rho);
+            columns = k + j + 1;
+
+            if (rho < tol) {
+                finished = true;
+                break;
+            }
+            if (h[count] == 0) break;
+
+            Zee::scale((TVal)1 / h[count], w, v);
+            std::copy(v.data(), v.data() + n, basis.begin() + (j + 1) * n);
+            statistics.lap(phase::vector_update);
+        }
+
+        auto y = leastSquares.solve();
+        statistics.lap(phase::other);
+        Zee::detail::multiAxpy<TVal>(n, (TVal)1, Vhat.data(), y.size(),
+                                     y.data(), x.data());
+        statistics.lap(phase::vector_update);
+        beta = residual(A, x, b, r);
+        statistics.countSpMV();
+        statistics.countReduction();
+        statistics.lap(phase::spmv);
+
+        // the estimate assumes that r is orthogonal to C, so convergence is
+        // verified explicitly
+        if (finished) {
+            finished = (beta < tol);
+            if (finished) break;
+            continue;
+        }
+        if (kmax == 0 || columns < m) continue;
+
+        // the harmonic Ritz vectors [U V] P, with [C V]^T [U V] for the
+        // harmonic problem
+        std::vector<double> Gd(G.begin(), G.end());
+        std::vector<double> WV(rows * m, 0);
+        for (std::size_t i = 0; i < k; ++i) {
+            Zee::detail::multiDot<TVal>(n, What.data(), rows, U[i].data(),
+                                        h.data());
+            std::copy(h.begin(), h.end(), WV.begin() + i * rows);
+            statistics.countReduction(rows);
+        }
+        statistics.lap(phase::orthogonalization);
+        for (std::size_t j = 0; j < steps; ++j) {
+            WV[(k + j) * rows + k + j] = 1;
+        }
+
+        std::vector<double> P;
+        auto kept = Zee::detail::recycledRitzBasis(m, kmax, Gd, WV, P);
+        if (kept == 0) continue;
+
+        // G P = Q T, so that C = [C V] Q and U = [U V] P T^{-1}
+        std::vector<std::vector<double>> GP(kept, std::vector<double>(rows));
+        for (std::size_t j = 0; j < kept; ++j) {
+            for (std::size_t l = 0; l < m; ++l) {
+                for (std::size_t i = 0; i < rows; ++i) {
+                    GP[j][i] += Gd[l * rows + i] * P[j * m + l];
+                }
+            }
+        }
+        std::vector<double> Q;
+        if (Zee::detail::orthonormalize(rows, GP, Q) < kept) continue;
+
+        std::vector<double> T(kept * kept, 0);
+        for (std::size_t j = 0; j < kept; ++j) {
+            for (std::size_t i = 0; i <= j; ++i) {
+                double sum = 0;
+                for (std::size_t l = 0; l < rows; ++l) {
+                    sum += Q[i * rows + l] * GP[j][l];
+                }
+                T[j * kept + i] = sum;
+            }
+        }
+
+        // the columns of P T^{-1}, by back substitution
+        std::vector<double> Z(P);
+        for (std::size_t j = 0; j < kept; ++j) {
+            for (std::size_t l = 0; l < j; ++l) {
+                for (std::size_t i = 0; i < m; ++i) {
+                    Z[j * m + i] -= T[j * kept + l] * Z[l * m + i];
+                }
+            }
+            for (std::size_t i = 0; i < m; ++i) {
+                Z[j * m + i] /= T[j * kept + j];
+            }
+        }
+
+        std::vector<TVector> newU;
+        std::vector<TVector> newC;
+        std::vector<TVal> coefficients(rows);
+        for (std::size_t j = 0; j < kept; ++j) {
+            newU.emplace_back(n);
+            newU.back().reset();
+            std::copy(Z.begin() + j * m, Z.begin() + (j + 1) * m,
+                      coefficients.begin());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)1, Vhat.data(), m,
+                                         coefficients.data(),
+                                         newU.back().data());
+
+            newC.emplace_back(n);
+            newC.back().reset();
+            std::copy(Q.begin() + j * rows, Q.begin() + (j + 1) * rows,
+                      coefficients.begin());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)1, What.data(), rows,
+                                         coefficients.data(),
+                                         newC.back().data());
+        }
+        U = std::move(newU);
+        C = std::move(newC);
+        statistics.lap(phase::orthogonalization);
+    }
+
+    pool.release(std::move(basis));
+
+    statistics.finish();
+
+    return statistics.getResiduals();
+}
+
+/** Solve Ax = b using GCRO-DR(m, k), with m = inner_iterations, which
+ * recycles a subspace of dimension k from one solve to the next.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveRecycled(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                RecycledSubspace<TVal, TIdx>& space,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TVal tol, bool plotResiduals = false,
+                                bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solveRecycled(A, b, x, space, outer_iterations,
+                              inner_iterations, tol, statistics);
+
+    if (benchmark) statistics.report("GCRO-DR");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto p = Zee::Plotter<TVal>();
+        p["xlabel"] = "iterations";
+        p["ylabel"] = "$\\rho$";
+        p["yscale"] = "log";
+        p["title"] = "GCRO-DR: residual norm";
+        p.addLine(rhos, "rhos");
+        p.plot("residual_test_recycled", true);
+    }
+
+    return rhos;
+}
+
+}  // namespace GMRES
+
+}  // namespace Zee
@@ -2,158 +2,225 @@
 
 #include <vector>
 
+#include "hessenberg.hpp"
+#include "preconditioners.hpp"
+#include "statistics.hpp"
+
 namespace Zee {
 
 namespace GMRES {
 
-template <typename TVal, typename TIdx>
-void solve(Zee::DSparseMatrix<TVal, TIdx>& A, const Zee::DVector<TVal, TIdx>& b,
-           Zee::DVector<TVal, TIdx>& x, TIdx outer_iterations,
-           TIdx inner_iterations, TVal tol, bool plotResiduals = false,
-           bool benchmark = false) {
+/** The orthogonalization scheme used to extend the Krylov basis */
+enum class orthogonalization {
+    /** Modified Gram-Schmidt, with a separate reduction for every basis
+     * vector */
+    mgs,
+    /** Classical Gram-Schmidt with a reorthogonalization pass. Each pass is a
+     * single block reduction, and the two passes together are as stable as
+     * modified Gram-Schmidt. */
+    cgs2
+};
+
+/** Solve Ax = b using restarted GMRES(m), with m = inner_iterations, and
+ * right preconditioner M. The Krylov subspace is built for \f$A M^{-1}\f$,
+ * so the residual estimates are those of the original system.
+ *
+ * The solve is recorded in `statistics`: the residual norm estimate of every
+ * iteration, the time spent in each `solver_phase`, and the number of SpMVs,
+ * reductions and bytes communicated. Its callback, if set, is called after
+ * every iteration.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx outer_iterations, TIdx inner_iterations, TVal tol,
+                        SolverStatistics<TVal>& statistics,
+                        orthogonalization orth = orthogonalization::mgs) {
     JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
               << A.getCols() << " with " << A.nonZeros() << " non-zeros"
               << endLog;
 
-    auto& m = inner_iterations;
-
-    // FIXME pointless to make bench if we dont benchmark
-    auto bench = Zee::Benchmark("GMRES");
-    if (!benchmark) bench.silence();
-
     JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
 
     using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
 
     // make sure m is not larger than RHS vector
-    m = std::min(A.getRows(), m);
+    auto m = std::min(n, inner_iterations);
+
+    statistics.start();
 
-    TVector r = b;
-    TVector e{A.getRows()};
+    // the residual and its norm are computed in a single sweep
+    TVector r(n);
+    auto beta = residual(A, x, b, r);
+    statistics.countSpMV();
+    statistics.countReduction();
+    statistics.lap(phase::spmv);
 
-    // We store V as a (centralized) pseudo matrix
-    // I would think this is fine as long as m is small
-    // This contains the orthogonal basis of our Krylov subspace
-    std::vector<TVector> V(m, TVector(r.size()));
+    // The workspace below draws its storage from the vector pool, so repeated
+    // solves of the same dimensions do not allocate.
 
-    // We store the upper Hessenberg H matrix containing increasingly
-    // large vectors
-    std::vector<TVector> H;
-    H.reserve(m);
+    // The orthonormal basis V of our Krylov subspace is stored as a single
+    // contiguous block of m columns
+    auto& pool = VectorPool<TVal>::global();
+    auto basis = pool.acquire((std::size_t)n * m);
+    std::vector<const TVal*> V(m);
     for (TIdx i = 0; i < m; ++i) {
-        H.push_back(TVector(i + 2));
+        V[i] = basis.data() + (std::size_t)i * n;
     }
 
-    // Similarly we store the matrix R
-    std::vector<TVector> R(m, TVector(r.size()));
-
-    // Store \hat{b}
-    TVector bHat(A.getRows());
+    // Writes u / norm into column i of the basis
+    auto setColumn = [&](TIdx i, const TVector& u, TVal norm) {
+        const auto* us = u.data();
+        auto* vs = basis.data() + (std::size_t)i * n;
+        detail::elementwise(n, [=](std::size_t begin, std::size_t end) {
+            for (auto k = begin; k < end; ++k) {
+                vs[k] = us[k] / norm;
+            }
+        });
+    };
 
-    // Additional variables used for the algorithm
-    std::vector<TVal> c(m);
-    std::vector<TVal> s(m);
-    std::vector<TVal> y(m);
+    // The new basis vector in every iteration, and the preconditioned basis
+    // vector (or update of x)
+    TVector w(n);
+    TVector z(n);
 
-    std::vector<TVal> rhos;
+    // The current column of the Hessenberg matrix, which is reduced to the
+    // packed triangular factor R by the least-squares solver
+    std::vector<TVal> h(m + 1);
+    std::vector<TVal> correction(m);
+    detail::HessenbergLeastSquares<TVal> leastSquares(m);
+    statistics.lap(phase::other);
 
     auto finished = false;
-    TIdx nr = 0;
-    for (TIdx run = 0; run < outer_iterations; ++run) {
+    for (TIdx run = 0; run < outer_iterations && !finished; ++run) {
+        if (run > 0) statistics.countRestart();
+
         // We construct the initial basis vector from the residual
-        auto beta = r.norm();
-        V[0] = r / beta;
-        bHat.reset();
-        bHat[0] = beta;
+        if (beta < tol) break;
+
+        setColumn(0, r, beta);
+        leastSquares.reset(beta);
+        statistics.lap(phase::vector_update);
+
+        // The latest basis vector v is only stored in the basis, so the
+        // preconditioner is applied to the vector q = alpha v that it was
+        // normalized from. The factor alpha is divided out of w by the last
+        // update of the orthogonalization.
+        const TVector* q = &r;
+        auto alpha = beta;
 
         // We run for i [0, m)
         for (TIdx i = 0; i < m; ++i) {
             // We introduce a new basis vector which we will orthogonalize
-            // using modified Gramm-Schmidt
-            TVector w(A.getRows());
-
-            w = A * V[i];
-
-            for (TIdx k = 0; k <= i; ++k) {
-                H[i][k] = V[k].dot(w);
-                w -= V[k] * H[i][k];
-            }
-
-            H[i][i + 1] = w.norm();
-
-            if (i != m - 1) V[i + 1] = w / H[i][i + 1];
-
-            R[i][0] = H[i][0];
-
-            // Givens rotation
-            for (TIdx k = 1; k <= i; ++k) {
-                auto gamma = c[k - 1] * R[i][k - 1] + s[k - 1] * H[i][k];
-                R[i][k] = c[k - 1] * H[i][k] - s[k - 1] * R[i][k - 1];
-                R[i][k - 1] = gamma;
+            // against the current basis
+            M.apply(*q, z);
+            statistics.lap(phase::preconditioning);
+            w = A * z;
+            statistics.countSpMV();
+            statistics.lap(phase::spmv);
+
+            if (orth == orthogonalization::mgs) {
+                for (TIdx k = 0; k <= i; ++k) {
+                    detail::multiDot<TVal>(n, &V[k], 1, w.data(), &h[k]);
+                    auto last = (k == i) ? 1 / alpha : (TVal)1;
+                    detail::multiAxpy<TVal>(n, -last, &V[k], 1, &h[k],
+                                            w.data(), last);
+                    statistics.countReduction();
+                }
+            } else {
+                detail::multiDot<TVal>(n, V.data(), i + 1, w.data(), h.data());
+                detail::multiAxpy<TVal>(n, (TVal)-1, V.data(), i + 1, h.data(),
+                                        w.data());
+
+                detail::multiDot<TVal>(n, V.data(), i + 1, w.data(),
+                                       correction.data());
+                detail::multiAxpy<TVal>(n, -1 / alpha, V.data(), i + 1,
+                                        correction.data(), w.data(),
+                                        1 / alpha);
+                for (TIdx k = 0; k <= i; ++k) {
+                    h[k] += correction[k];
+                }
+                statistics.countReduction(i + 1);
+                statistics.countReduction(i + 1);
             }
-
-            // update c and s
-            auto delta = sqrt(R[i][i] * R[i][i] + H[i][i + 1] * H[i][i + 1]);
-
-            if (delta < 1e-6) {
-                nr = i;
-                finished = true;
-                break;
+            for (TIdx k = 0; k <= i; ++k) {
+                h[k] /= alpha;
             }
+            statistics.lap(phase::orthogonalization);
 
-            c[i] = R[i][i] / delta;
-            s[i] = H[i][i + 1] / delta;
-
-            // update r_i and bHat
-            R[i][i] = c[i] * R[i][i] + s[i] * H[i][i + 1];
-            bHat[i + 1] = -s[i] * bHat[i];
-            bHat[i] = c[i] * bHat[i];
+            h[i + 1] = w.norm();
+            statistics.countReduction();
+            statistics.lap(phase::synchronization);
 
-            // update rho
-            auto rho = std::abs(bHat[i + 1]);
-            rhos.push_back(rho);
+            // Givens rotations, and the update of rho
+            auto rho = leastSquares.addColumn(h.data());
+            statistics.addIteration(rho);
 
             // check if we are within tolerance level
             if (rho < tol) {
-                nr = i;
                 finished = true;
                 break;
             }
-        }
 
-        // reconstruct x
-        if (!finished) {
-            nr = m - 1;
-            y[nr] = bHat[nr] / R[nr][nr];
-        }
-
-        if (nr > 0) {
-            // subtract sum
-            for (TIdx k = nr - 1;; --k) {
-                TVal sum = 0;
-                for (TIdx i = k + 1; i <= nr; ++i) {
-                    sum += R[i][k] * y[i];
-                }
+            // the Krylov subspace is invariant, so x is as good as it gets
+            if (h[i + 1] == 0) break;
 
-                y[k] = (bHat[k] - sum) / R[k][k];
-
-                if (k == 0) break;
+            if (i + 1 < m) {
+                setColumn(i + 1, w, h[i + 1]);
+                q = &w;
+                alpha = h[i + 1];
             }
+            statistics.lap(phase::vector_update);
         }
 
-        for (TIdx i = 0; i < nr; ++i) {
-            x = x + y[i] * V[i];
-        }
+        // reconstruct x, from the solution y of R y = bHat
+        auto y = leastSquares.solve();
+        statistics.lap(phase::other);
+        w.reset();
+        detail::multiAxpy<TVal>(n, (TVal)1, V.data(), y.size(), y.data(),
+                                w.data());
+        statistics.lap(phase::vector_update);
+        M.apply(w, z);
+        statistics.lap(phase::preconditioning);
+        Zee::axpby((TVal)1, z, (TVal)1, x);
+        statistics.lap(phase::vector_update);
+
+        beta = residual(A, x, b, r);
+        statistics.countSpMV();
+        statistics.countReduction();
+        statistics.lap(phase::spmv);
+    }
 
-        r = b - A * x;
+    pool.release(std::move(basis));
+    statistics.finish();
 
-        if (finished) {
-            break;
-        }
+    return statistics.getResiduals();
+}
+
+/** Solve Ax = b using restarted GMRES(m), with m = inner_iterations, and
+ * right preconditioner M.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, const TPreconditioner& M,
+                        TIdx outer_iterations, TIdx inner_iterations, TVal tol,
+                        bool plotResiduals = false, bool benchmark = false,
+                        orthogonalization orth = orthogonalization::mgs) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
     }
+    auto rhos = solve(A, b, x, M, outer_iterations, inner_iterations, tol,
+                      statistics, orth);
 
-    // we finalize the benchmark
-    if (benchmark) bench.finish();
+    if (benchmark) statistics.report("GMRES");
 
     if (plotResiduals) {
         JWLogVar(rhos);
@@ -166,6 +233,34 @@ void solve(Zee::DSparseMatrix<TVal, TIdx>& A, const Zee::DVector<TVal, TIdx>& b,
         p.addLine(rhos, "rhos");
         p.plot("residual_test", true);
     }
+
+    return rhos;
+}
+
+/** Solve Ax = b using restarted GMRES(m) without preconditioning, recording
+ * the solve in `statistics` */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx outer_iterations,
+                        TIdx inner_iterations, TVal tol,
+                        SolverStatistics<TVal>& statistics,
+                        orthogonalization orth = orthogonalization::mgs) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 outer_iterations, inner_iterations, tol, statistics, orth);
+}
+
+/** Solve Ax = b using restarted GMRES(m) without preconditioning */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx outer_iterations,
+                        TIdx inner_iterations, TVal tol,
+                        bool plotResiduals = false, bool benchmark = false,
+                        orthogonalization orth = orthogonalization::mgs) {
+    return solve(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                 outer_iterations, inner_iterations, tol, plotResiduals,
+                 benchmark, orth);
 }
 
 }  // namespace GMRES
@@ -0,0 +1,408 @@
+/*
+File: include/solvers/gmres_dr.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "dense_eigen.hpp"
+#include "hessenberg.hpp"
+#include "preconditioners.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** The state of GMRES-DR that is carried over a deflated restart: the
+ * projected matrix of the kept subspace, stored by columns with m + 1 rows,
+ * and the right-hand side of the least-squares problem */
+template <typename TVal>
+struct DeflatedRestart {
+    std::size_t kept = 0;
+    std::vector<TVal> H;
+    std::vector<TVal> g;
+};
+
+/** Computes the coefficients P, an orthonormal (m + 1) x (k + 1) matrix
+ * stored by columns, of the basis that GMRES-DR keeps after a cycle. The
+ * first k columns span (the real and imaginary parts of) the harmonic Ritz
+ * vectors of the k harmonic Ritz values of smallest magnitude, and the last
+ * column is the residual of the least-squares problem, rc.
+ * @return the number of harmonic Ritz vectors k, which can be one more than
+ * requested to keep a complex conjugate pair together */
+inline std::size_t harmonicRitzBasis(std::size_t m, std::size_t k,
+                                     const std::vector<double>& Hbar,
+                                     const std::vector<double>& rc,
+                                     std::vector<double>& P) {
+    auto rows = m + 1;
+
+    // G = H_m + h_{m + 1, m}^2 H_m^{-T} e_m e_m^T
+    std::vector<double> G(m * m);
+    std::vector<double> transposed(m * m);
+    for (std::size_t j = 0; j < m; ++j) {
+        for (std::size_t i = 0; i < m; ++i) {
+            G[j * m + i] = Hbar[j * rows + i];
+            transposed[i * m + j] = Hbar[j * rows + i];
+        }
+    }
+    std::vector<double> em(m, 0);
+    em[m - 1] = 1;
+    auto f = solveDense(m, transposed, em);
+    auto subdiagonal = Hbar[(m - 1) * rows + m];
+    for (std::size_t i = 0; i < m; ++i) {
+        G[(m - 1) * m + i] += subdiagonal * subdiagonal * f[i];
+    }
+
+    // the harmonic Ritz vectors of the values of smallest magnitude, padded
+    // to m + 1 rows
+    auto vectors = eigenvectorBasis(
+        m, G, k, m - 1,
+        [](std::complex<double> a, std::complex<double> b) {
+            return std::abs(a) < std::abs(b);
+        });
+    for (auto& u : vectors) u.push_back(0);
+
+    P.clear();
+    auto kept = orthonormalize(rows, vectors, P);
+    if (orthonormalize(rows, {rc}, P) == 0) return 0;
+
+    return kept;
+}
+
+}  // namespace detail
+
+namespace GMRES {
+
+/** Solve Ax = b using GMRES with deflated restarting, GMRES-DR(m, k), with
+ * m = inner_iterations and k = deflation, and right preconditioner M.
+ *
+ * Restarted GMRES discards the Krylov subspace at every restart, which makes
+ * it stagnate when A has eigenvalues close to zero. GMRES-DR instead keeps the
+ * k harmonic Ritz vectors of the smallest harmonic Ritz values, which
+ * approximate the corresponding eigenvectors, together with the residual.
+ * The next cycle extends this subspace by m - k Arnoldi steps, so that the
+ * small eigenvalues are deflated after a few cycles, while the memory use
+ * stays that of GMRES(m).
+ *
+ * The kept basis is formed from the old basis in place, without SpMVs. The
+ * first k columns of the projected matrix of the next cycle are full, and the
+ * least-squares problems are solved by `GivensLeastSquares`. Since the
+ * residual estimate of a deflated cycle is carried over from the previous
+ * cycles, convergence is confirmed with the true residual.
+ *
+ * The solve is recorded in `statistics`, as for `solve`.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solveDeflated(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                const TPreconditioner& M,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TIdx deflation, TVal tol,
+                                SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (deflated restarting, k = " << deflation << ")"
+              << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+    auto m = std::min(n, inner_iterations);
+
+    // at least one Arnoldi step per cycle, also for a complex pair
+    auto k = (m > 2) ? std::min((std::size_t)deflation, (std::size_t)m - 2)
+                     : (std::size_t)0;
+    auto rows = (std::size_t)m + 1;
+
+    statistics.start();
+
+    TVector r(n);
+    auto beta = residual(A, x, b, r);
+    statistics.countSpMV();
+    statistics.countReduction();
+    statistics.lap(phase::spmv);
+
+    // the basis, as a single contiguous block of m + 1 columns
+    auto& pool = VectorPool<TVal>::global();
+    auto basis = pool.acquire((std::size_t)n * rows);
+    std::vector<const TVal*> V(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        V[i] = basis.data() + i * n;
+    }
+
+    TVector v(n);
+    TVector w(n);
+    TVector z(n);
+
+    // the projected matrix of the cycle, stored by columns
+    std::vector<TVal> Hbar(rows * m);
+    std::vector<TVal> h(rows);
+    std::vector<TVal> correction(rows);
+    Zee::detail::GivensLeastSquares<TVal> leastSquares(m);
+    Zee::detail::DeflatedRestart<TVal> restart;
+    statistics.lap(phase::other);
+
+    auto finished = false;
+    for (TIdx run = 0; run < outer_iterations && !finished; ++run) {
+        if (run > 0) statistics.countRestart();
+
+        std::fill(Hbar.begin(), Hbar.end(), (TVal)0);
+        std::vector<TVal> g(rows, 0);
+
+        std::size_t start = 0;
+        if (restart.kept == 0) {
+            if (beta < tol) break;
+
+            Zee::scale((TVal)1 / beta, r, v);
+            std::copy(v.data(), v.data() + n, basis.begin());
+            g[0] = beta;
+            leastSquares.reset(g.data(), 1);
+            statistics.lap(phase::vector_update);
+        } else {
+            start = restart.kept;
+            std::copy(restart.H.begin(), restart.H.end(), Hbar.begin());
+            std::copy(restart.g.begin(), restart.g.end(), g.begin());
+            leastSquares.reset(g.data(), start + 1);
+            for (std::size_t j = 0; j < start; ++j) {
+                leastSquares.addColumn(Hbar.data() + j * rows, start + 1);
+            }
+            std::copy(V[start], V[start] + n, v.data());
+            statistics.lap(phase::other);
+        }
+
+        std::size_t columns = start;
+        for (auto i = start; i < m; ++i) {
+            M.apply(v, z);
+            statistics.lap(phase::preconditioning);
+            w = A * z;
+            statistics.countSpMV();
+            statistics.lap(phase::spmv);
+
+            // CGS2
+            Zee::detail::multiDot<TVal>(n, V.data(), i + 1, w.data(),
+                                        h.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)-1, V.data(), i + 1,
+                                         h.data(), w.data());
+            Zee::detail::multiDot<TVal>(n, V.data(), i + 1, w.data(),
+                                        correction.data());
+            Zee::detail::multiAxpy<TVal>(n, (TVal)-1, V.data(), i + 1,
+                                         correction.data(), w.data());
+            for (std::size_t l = 0; l <= i; ++l) {
+                h[l] += correction[l];
+            }
+            h[i + 1] = w.norm();
+            statistics.countReduction(i + 1);
+            statistics.countReduction(i + 1);
+            statistics.countReduction();
+            statistics.lap(phase::orthogonalization);
+            std::copy(h.begin(), h.begin() + i + 2, Hbar.begin() + i * rows);
+
+            auto rho = leastSquares.addColumn(h.data(), i + 2);
+            statistics.addIteration(rho);
+            columns = i + 1;
+
+            if (rho < tol) {
+                finished = true;
+                break;
+            }
+            if (h[i + 1] == 0) break;
+
+            Zee::scale((TVal)1 / h[i + 1], w, v);
+            std::copy(v.data(), v.data() + n, basis.begin() + (i + 1) * n);
+            statistics.lap(phase::vector_update);
+        }
+
+        auto y = leastSquares.solve();
+        statistics.lap(phase::other);
+        w.reset();
+        Zee::detail::multiAxpy<TVal>(n, (TVal)1, V.data(), y.size(), y.data(),
+                                     w.data());
+        statistics.lap(phase::vector_update);
+        M.apply(w, z);
+        statistics.lap(phase::preconditioning);
+        Zee::axpby((TVal)1, z, (TVal)1, x);
+        statistics.lap(phase::vector_update);
+
+        // the residual estimate of a deflated cycle relies on the projection
+        // of the previous cycles, so convergence is verified explicitly
+        auto deflated = (start > 0);
+        restart.kept = 0;
+        // computes the true residual r = b - Ax, and its norm
+        auto updateResidual = [&]() {
+            beta = residual(A, x, b, r);
+            statistics.countSpMV();
+            statistics.countReduction();
+            statistics.lap(phase::spmv);
+        };
+        if (finished && deflated) {
+            updateResidual();
+            finished = (beta < tol);
+            if (!finished) continue;
+        }
+        if (finished) break;
+
+        // a deflated restart is only possible after a complete cycle
+        if (k == 0 || columns < m) {
+            updateResidual();
+            continue;
+        }
+
+        // the residual of the least-squares problem, r = V rc
+        std::vector<double> H(Hbar.begin(), Hbar.end());
+        std::vector<double> rc(rows);
+        for (std::size_t i = 0; i < rows; ++i) {
+            double sum = g[i];
+            for (std::size_t j = 0; j < m; ++j) {
+                sum -= H[j * rows + i] * y[j];
+            }
+            rc[i] = sum;
+        }
+
+        std::vector<double> P;
+        auto kept = Zee::detail::harmonicRitzBasis(m, k, H, rc, P);
+        if (kept == 0) {
+            updateResidual();
+            continue;
+        }
+
+        // the projected matrix P^T Hbar P_k, and right-hand side P^T rc
+        restart.kept = kept;
+        restart.H.assign(rows * kept, 0);
+        restart.g.assign(kept + 1, 0);
+        for (std::size_t j = 0; j < kept; ++j) {
+            std::vector<double> column(rows, 0);
+            for (std::size_t l = 0; l < m; ++l) {
+                for (std::size_t i = 0; i < rows; ++i) {
+                    column[i] += H[l * rows + i] * P[j * rows + l];
+                }
+            }
+            for (std::size_t i = 0; i <= kept; ++i) {
+                double sum = 0;
+                for (std::size_t l = 0; l < rows; ++l) {
+                    sum += P[i * rows + l] * column[l];
+                }
+                restart.H[j * rows + i] = (TVal)sum;
+            }
+        }
+        for (std::size_t i = 0; i <= kept; ++i) {
+            double sum = 0;
+            for (std::size_t l = 0; l < rows; ++l) {
+                sum += P[i * rows + l] * rc[l];
+            }
+            restart.g[i] = (TVal)sum;
+        }
+        statistics.lap(phase::other);
+
+        // the new basis V P, in place
+        auto kept_basis = pool.acquire((std::size_t)n * (kept + 1));
+        std::fill(kept_basis.begin(), kept_basis.end(), (TVal)0);
+        std::vector<TVal> coefficients(rows);
+        for (std::size_t j = 0; j <= kept; ++j) {
+            for (std::size_t l = 0; l < rows; ++l) {
+                coefficients[l] = (TVal)P[j * rows + l];
+            }
+            Zee::detail::multiAxpy<TVal>(n, (TVal)1, V.data(), rows,
+                                         coefficients.data(),
+                                         kept_basis.data() + j * n);
+        }
+        std::copy(kept_basis.begin(), kept_basis.end(), basis.begin());
+        pool.release(std::move(kept_basis));
+        statistics.lap(phase::vector_update);
+    }
+
+    pool.release(std::move(basis));
+
+    statistics.finish();
+
+    return statistics.getResiduals();
+}
+
+/** Solve Ax = b using GMRES-DR(m, k), with m = inner_iterations and
+ * k = deflation, and right preconditioner M.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solveDeflated(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                const TPreconditioner& M,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TIdx deflation, TVal tol,
+                                bool plotResiduals = false,
+                                bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solveDeflated(A, b, x, M, outer_iterations, inner_iterations,
+                              deflation, tol, statistics);
+
+    if (benchmark) statistics.report("GMRES-DR");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto p = Zee::Plotter<TVal>();
+        p["xlabel"] = "iterations";
+        p["ylabel"] = "$\\rho$";
+        p["yscale"] = "log";
+        p["title"] = "GMRES-DR: residual norm";
+        p.addLine(rhos, "rhos");
+        p.plot("residual_test_deflated", true);
+    }
+
+    return rhos;
+}
+
+/** Solve Ax = b using GMRES-DR(m, k) without preconditioning, recording the
+ * solve in `statistics` */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveDeflated(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TIdx deflation, TVal tol,
+                                SolverStatistics<TVal>& statistics) {
+    return solveDeflated(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                         outer_iterations, inner_iterations, deflation, tol,
+                         statistics);
+}
+
+/** Solve Ax = b using GMRES-DR(m, k) without preconditioning */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveDeflated(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                const Zee::DVector<TVal, TIdx>& b,
+                                Zee::DVector<TVal, TIdx>& x,
+                                TIdx outer_iterations, TIdx inner_iterations,
+                                TIdx deflation, TVal tol,
+                                bool plotResiduals = false,
+                                bool benchmark = false) {
+    return solveDeflated(A, b, x, IdentityPreconditioner<TVal, TIdx>(),
+                         outer_iterations, inner_iterations, deflation, tol,
+                         plotResiduals, benchmark);
+}
+
+}  // namespace GMRES
+
+}  // namespace Zee
@@ -0,0 +1,332 @@
+/*
+File: include/solvers/hessenberg.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "jw.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** Solves the least-squares problem
+ * \f[ \min_y \| \beta e_1 - \bar{H} y \| \f]
+ * of GMRES, where \f$\bar{H}\f$ is the upper Hessenberg matrix built by the
+ * Arnoldi process. The columns of \f$\bar{H}\f$ are added one at a time, and
+ * are reduced to an upper triangular matrix R by Givens rotations. R is stored
+ * packed by columns, so it takes m (m + 1) / 2 values. */
+template <typename TVal>
+class HessenbergLeastSquares {
+   public:
+    explicit HessenbergLeastSquares(std::size_t m)
+        : m_(m), R_(m * (m + 1) / 2), c_(m), s_(m), g_(m + 1) {}
+
+    /** Start a new problem with right-hand side \f$\beta e_1\f$ */
+    void reset(TVal beta) {
+        std::fill(g_.begin(), g_.end(), (TVal)0);
+        g_[0] = beta;
+        k_ = 0;
+    }
+
+    /** Add the next column of \f$\bar{H}\f$, given by its k + 2 leading
+     * entries h[0], ..., h[k + 1].
+     * @return the norm of the residual of the updated problem */
+    TVal addColumn(const TVal* h) {
+        auto k = k_;
+        JWAssert(k < m_);
+
+        auto r = column_(k);
+        std::copy(h, h + k + 1, r);
+
+        // apply the previous rotations to the new column
+        for (std::size_t j = 0; j < k; ++j) {
+            auto gamma = c_[j] * r[j] + s_[j] * r[j + 1];
+            r[j + 1] = c_[j] * r[j + 1] - s_[j] * r[j];
+            r[j] = gamma;
+        }
+
+        // and find a rotation that eliminates the subdiagonal element
+        auto delta = std::hypot(r[k], h[k + 1]);
+        c_[k] = (delta == 0) ? 1 : r[k] / delta;
+        s_[k] = (delta == 0) ? 0 : h[k + 1] / delta;
+        r[k] = delta;
+
+        g_[k + 1] = -s_[k] * g_[k];
+        g_[k] = c_[k] * g_[k];
+
+        k_++;
+        return std::abs(g_[k + 1]);
+    }
+
+    /** @return the norm of the current residual */
+    TVal residual() const { return std::abs(g_[k_]); }
+
+    /** @return the number of columns added since the last reset */
+    std::size_t size() const { return k_; }
+
+    /** @return the element (i, j) of the triangular factor R */
+    TVal r(std::size_t i, std::size_t j) const {
+        return (i <= j) ? R_[j * (j + 1) / 2 + i] : (TVal)0;
+    }
+
+    /** Solve for y by back substitution */
+    std::vector<TVal> solve() const {
+        std::vector<TVal> y(k_);
+        for (std::size_t j = k_; j-- > 0;) {
+            auto sum = g_[j];
+            for (auto l = j + 1; l < k_; ++l) {
+                sum -= r(j, l) * y[l];
+            }
+            y[j] = (r(j, j) == 0) ? 0 : sum / r(j, j);
+        }
+        return y;
+    }
+
+   private:
+    TVal* column_(std::size_t j) { return R_.data() + j * (j + 1) / 2; }
+
+    std::size_t m_ = 0;
+    std::size_t k_ = 0;
+    std::vector<TVal> R_;
+    std::vector<TVal> c_;
+    std::vector<TVal> s_;
+    std::vector<TVal> g_;
+};
+
+/** Solves the least-squares problem \f$\min_y \| g - \bar{H} y \|\f$ for a
+ * general right-hand side g, where the columns of \f$\bar{H}\f$ may extend
+ * further below the diagonal than those of a Hessenberg matrix. This occurs
+ * after a deflated restart, where the leading columns of the projected matrix
+ * are full. Each column is reduced by Givens rotations of neighbouring rows,
+ * from the bottom up, and the rotations are kept in a single list. */
+template <typename TVal>
+class GivensLeastSquares {
+   public:
+    explicit GivensLeastSquares(std::size_t m)
+        : m_(m), R_(m * (m + 1) / 2), g_(m + 1), column_(m + 1) {}
+
+    /** Start a new problem with right-hand side g[0], ..., g[length - 1] */
+    void reset(const TVal* g, std::size_t length) {
+        JWAssert(length <= m_ + 1);
+        std::fill(g_.begin(), g_.end(), (TVal)0);
+        std::copy(g, g + length, g_.begin());
+        rotations_.clear();
+        k_ = 0;
+    }
+
+    /** Add the next column of \f$\bar{H}\f$, given by its leading entries
+     * h[0], ..., h[length - 1], where length is at least k + 1.
+     * @return the norm of the residual of the updated problem */
+    TVal addColumn(const TVal* h, std::size_t length) {
+        auto k = k_;
+        JWAssert(k < m_);
+        JWAssert(length > k && length <= m_ + 1);
+
+        std::fill(column_.begin(), column_.end(), (TVal)0);
+        std::copy(h, h + length, column_.begin());
+
+        for (auto& rotation : rotations_) {
+            rotate_(rotation, column_[rotation.row], column_[rotation.row + 1]);
+        }
+
+        for (auto i = length; i-- > k + 1;) {
+            auto delta = std::hypot(column_[i - 1], column_[i]);
+            Rotation rotation{i - 1, (delta == 0) ? 1 : column_[i - 1] / delta,
+                              (delta == 0) ? 0 : column_[i] / delta};
+            column_[i - 1] = delta;
+            column_[i] = 0;
+            rotate_(rotation, g_[i - 1], g_[i]);
+            rotations_.push_back(rotation);
+        }
+
+        std::copy(column_.begin(), column_.begin() + k + 1,
+                  R_.begin() + k * (k + 1) / 2);
+        k_++;
+        return residual();
+    }
+
+    /** @return the norm of the current residual */
+    TVal residual() const {
+        TVal norm = 0;
+        for (auto i = k_; i <= m_; ++i) {
+            norm = std::hypot(norm, g_[i]);
+        }
+        return norm;
+    }
+
+    /** @return the number of columns added since the last reset */
+    std::size_t size() const { return k_; }
+
+    /** Solve for y by back substitution */
+    std::vector<TVal> solve() const {
+        std::vector<TVal> y(k_);
+        for (std::size_t j = k_; j-- > 0;) {
+            auto sum = g_[j];
+            for (auto l = j + 1; l < k_; ++l) {
+                sum -= R_[l * (l + 1) / 2 + j] * y[l];
+            }
+            auto diagonal = R_[j * (j + 1) / 2 + j];
+            y[j] = (diagonal == 0) ? 0 : sum / diagonal;
+        }
+        return y;
+    }
+
+   private:
+    struct Rotation {
+        std::size_t row;
+        TVal c;
+        TVal s;
+    };
+
+    static void rotate_(const Rotation& rotation, TVal& a, TVal& b) {
+        auto gamma = rotation.c * a + rotation.s * b;
+        b = rotation.c * b - rotation.s * a;
+        a = gamma;
+    }
+
+    std::size_t m_ = 0;
+    std::size_t k_ = 0;
+    std::vector<TVal> R_;
+    std::vector<TVal> g_;
+    std::vector<TVal> column_;
+    std::vector<Rotation> rotations_;
+};
+
+/** Solves the least-squares problem
+ * \f[ \min_Y \| E_1 S - \bar{H} Y \|_F \f]
+ * of block GMRES with block size p, where \f$\bar{H}\f$ is the band upper
+ * Hessenberg matrix built by the block Arnoldi process, with p subdiagonals,
+ * and S is the p x p triangular factor of the initial block of residuals.
+ * Every subdiagonal entry is eliminated by its own Givens rotation, and the
+ * rotations are applied to all p right-hand sides. */
+template <typename TVal>
+class BlockHessenbergLeastSquares {
+   public:
+    /** A problem with at most m columns, and block size p */
+    BlockHessenbergLeastSquares(std::size_t m, std::size_t p)
+        : m_(m),
+          p_(p),
+          R_(m * (m + 1) / 2),
+          c_(m * p),
+          s_(m * p),
+          g_((m + p) * p),
+          column_(m + p) {}
+
+    /** Start a new problem with right-hand side \f$E_1 S\f$, for the p x p
+     * upper triangular S stored by columns */
+    void reset(const TVal* S) {
+        std::fill(g_.begin(), g_.end(), (TVal)0);
+        for (std::size_t l = 0; l < p_; ++l) {
+            for (std::size_t i = 0; i <= l; ++i) {
+                g_[l * (m_ + p_) + i] = S[l * p_ + i];
+            }
+        }
+        k_ = 0;
+    }
+
+    /** Add the next column of \f$\bar{H}\f$, given by its k + p + 1 leading
+     * entries h[0], ..., h[k + p] */
+    void addColumn(const TVal* h) {
+        auto k = k_;
+        JWAssert(k < m_);
+
+        auto& r = column_;
+        std::copy(h, h + k + p_ + 1, r.begin());
+
+        // apply the previous rotations, which each act on two neighbouring
+        // rows, to the new column
+        for (std::size_t j = 0; j < k; ++j) {
+            for (auto i = p_; i > 0; --i) {
+                rotate_(j * p_ + i - 1, r[j + i - 1], r[j + i]);
+            }
+        }
+
+        // and eliminate the subdiagonal entries from the bottom up
+        for (auto i = p_; i > 0; --i) {
+            auto top = k + i - 1;
+            auto delta = std::hypot(r[top], r[top + 1]);
+            auto rotation = k * p_ + i - 1;
+            c_[rotation] = (delta == 0) ? 1 : r[top] / delta;
+            s_[rotation] = (delta == 0) ? 0 : r[top + 1] / delta;
+            r[top] = delta;
+            r[top + 1] = 0;
+
+            for (std::size_t l = 0; l < p_; ++l) {
+                auto* g = g_.data() + l * (m_ + p_);
+                rotate_(rotation, g[top], g[top + 1]);
+            }
+        }
+
+        std::copy(r.begin(), r.begin() + k + 1, R_.begin() + k * (k + 1) / 2);
+        k_++;
+    }
+
+    /** @return the norm of the residual for right-hand side l */
+    TVal residual(std::size_t l) const {
+        const auto* g = g_.data() + l * (m_ + p_);
+        TVal norm = 0;
+        for (auto i = k_; i < k_ + p_; ++i) {
+            norm = std::hypot(norm, g[i]);
+        }
+        return norm;
+    }
+
+    /** @return the number of columns added since the last reset */
+    std::size_t size() const { return k_; }
+
+    /** Solve for Y by back substitution. Column l of Y is stored at
+     * offset l size(). */
+    std::vector<TVal> solve() const {
+        std::vector<TVal> Y(k_ * p_);
+        for (std::size_t l = 0; l < p_; ++l) {
+            const auto* g = g_.data() + l * (m_ + p_);
+            auto* y = Y.data() + l * k_;
+            for (std::size_t j = k_; j-- > 0;) {
+                auto sum = g[j];
+                for (auto i = j + 1; i < k_; ++i) {
+                    sum -= r_(j, i) * y[i];
+                }
+                y[j] = (r_(j, j) == 0) ? 0 : sum / r_(j, j);
+            }
+        }
+        return Y;
+    }
+
+   private:
+    TVal r_(std::size_t i, std::size_t j) const {
+        return R_[j * (j + 1) / 2 + i];
+    }
+
+    void rotate_(std::size_t rotation, TVal& a, TVal& b) const {
+        auto gamma = c_[rotation] * a + s_[rotation] * b;
+        b = c_[rotation] * b - s_[rotation] * a;
+        a = gamma;
+    }
+
+    std::size_t m_ = 0;
+    std::size_t p_ = 0;
+    std::size_t k_ = 0;
+    std::vector<TVal> R_;
+    std::vector<TVal> c_;
+    std::vector<TVal> s_;
+    std::vector<TVal> g_;
+    std::vector<TVal> column_;
+};
+
+}  // namespace detail
+
+}  // namespace Zee
@@ -0,0 +1,309 @@
+/*
+File: include/solvers/idrs.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "preconditioners.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace IDR {
+
+/** Solve Ax = b using the right-preconditioned IDR(s) method with
+ * preconditioner M, in the biorthogonal variant of van Gijzen and Sonneveld.
+ *
+ * IDR(s) keeps 3s + 5 vectors of size n, independent of the number of
+ * iterations, and for s = 1 it is mathematically equivalent to BiCGStab.
+ * Larger s typically converges in fewer SpMVs. The s projections onto the
+ * shadow space are computed with a single block reduction.
+ *
+ * The solve is recorded in `statistics`, with an iteration for every SpMV.
+ * @return the residual norm before the first SpMV, and after each SpMV */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx s,
+                        const TPreconditioner& M, TIdx max_iterations,
+                        TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros() << " non-zeros (IDR("
+              << s << "))" << endLog;
+
+    JWAssert(s > 0);
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+
+    statistics.start();
+
+    // the threshold for the angle between r and t in the choice of omega
+    const TVal kappa = 0.7;
+
+    // the shadow space is spanned by s random orthonormal vectors
+    std::vector<TVector> P(s, TVector(n));
+    std::mt19937 generator(42);
+    std::normal_distribution<TVal> normal;
+    for (TIdx k = 0; k < s; ++k) {
+        for (TIdx i = 0; i < n; ++i) {
+            P[k][i] = normal(generator);
+        }
+        for (TIdx j = 0; j < k; ++j) {
+            Zee::axpby(-P[j].dot(P[k]), P[j], (TVal)1, P[k]);
+            statistics.countReduction();
+        }
+        Zee::scale((TVal)1 / P[k].norm(), P[k]);
+        statistics.countReduction();
+    }
+
+    std::vector<TVector> G(s, TVector(n));
+    std::vector<TVector> U(s, TVector(n));
+
+    // the vectors are only written in place, so the pointers remain valid
+    auto columnsP = detail::columnPointers(P, s);
+    auto columnsG = detail::columnPointers(G, s);
+    auto columnsU = detail::columnPointers(U, s);
+
+    // Ms = P^T G, which is lower triangular, stored by rows
+    std::vector<TVal> Ms(s * s);
+    for (TIdx k = 0; k < s; ++k) {
+        Ms[k * s + k] = 1;
+    }
+
+    std::vector<TVal> f(s);
+    std::vector<TVal> c(s);
+
+    statistics.lap(phase::other);
+
+    TVector r(n);
+    r = b - A * x;
+    statistics.countSpMV();
+    statistics.lap(phase::spmv);
+    TVector v(n);
+    TVector vHat(n);
+    TVector t(n);
+
+    TVal omega = 1;
+
+    // the residual norm after an update of r
+    std::vector<TVal> rhos;
+    auto addResidual = [&]() {
+        rhos.push_back(r.norm());
+        statistics.countReduction();
+        statistics.lap(phase::synchronization);
+    };
+    addResidual();
+
+    TIdx iterations = 0;
+    auto converged = [&]() {
+        return rhos.back() < tol || iterations >= max_iterations;
+    };
+
+    auto breakdown = false;
+    while (!converged() && !breakdown) {
+        // f = P^T r
+        detail::multiDot<TVal>(n, columnsP.data(), s, r.data(), f.data());
+        statistics.countReduction(s);
+        statistics.lap(phase::synchronization);
+
+        for (TIdx k = 0; k < s; ++k) {
+            auto m = s - k;
+
+            // solve Ms(k:s, k:s) c = f(k:s)
+            for (TIdx i = k; i < s; ++i) {
+                auto sum = f[i];
+                for (TIdx j = k; j < i; ++j) {
+                    sum -= Ms[i * s + j] * c[j - k];
+                }
+                c[i - k] = sum / Ms[i * s + i];
+            }
+
+            // v = r - G(:, k:s) c
+            Zee::copy(r, v);
+            detail::multiAxpy<TVal>(n, (TVal)-1, columnsG.data() + k, m,
+                                    c.data(), v.data());
+            statistics.lap(phase::vector_update);
+            M.apply(v, vHat);
+            statistics.lap(phase::preconditioning);
+
+            // U(:, k) = U(:, k:s) c + omega M^{-1} v
+            Zee::scale(omega, vHat);
+            detail::multiAxpy<TVal>(n, (TVal)1, columnsU.data() + k, m,
+                                    c.data(), vHat.data());
+            Zee::copy(vHat, U[k]);
+            statistics.lap(phase::vector_update);
+
+            t = A * U[k];
+            statistics.countSpMV();
+            statistics.lap(phase::spmv);
+            Zee::copy(t, G[k]);
+            iterations++;
+
+            // make G(:, k) orthogonal to P(:, 0:k)
+            for (TIdx i = 0; i < k; ++i) {
+                auto alpha = P[i].dot(G[k]) / Ms[i * s + i];
+                Zee::axpby(-alpha, G[i], (TVal)1, G[k]);
+                Zee::axpby(-alpha, U[i], (TVal)1, U[k]);
+                statistics.countReduction();
+            }
+
+            // Ms(k:s, k) = P(:, k:s)^T G(:, k)
+            detail::multiDot<TVal>(n, columnsP.data() + k, m, G[k].data(),
+                                   c.data());
+            for (TIdx i = k; i < s; ++i) {
+                Ms[i * s + k] = c[i - k];
+            }
+            statistics.countReduction(m);
+            statistics.lap(phase::orthogonalization);
+
+            if (Ms[k * s + k] == 0) {
+                JWLogError << "IDR(s): breakdown after " << iterations
+                           << " iterations" << endLog;
+                breakdown = true;
+                break;
+            }
+
+            // make r orthogonal to P(:, 0:k + 1)
+            auto beta = f[k] / Ms[k * s + k];
+            Zee::axpby(-beta, G[k], (TVal)1, r);
+            Zee::axpby(beta, U[k], (TVal)1, x);
+            statistics.lap(phase::vector_update);
+
+            addResidual();
+            statistics.addIteration(rhos.back());
+            if (converged()) break;
+
+            for (TIdx i = k + 1; i < s; ++i) {
+                f[i] -= beta * Ms[i * s + k];
+            }
+        }
+
+        if (converged() || breakdown) break;
+
+        // the dimension reduction step
+        M.apply(r, vHat);
+        statistics.lap(phase::preconditioning);
+        t = A * vHat;
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+        iterations++;
+
+        // <r, t> and <t, t>
+        TVal products[2];
+        const TVal* columns[] = {r.data(), t.data()};
+        detail::multiDot<TVal>(n, columns, 2, t.data(), products);
+        statistics.countReduction(2);
+        statistics.lap(phase::synchronization);
+
+        if (products[1] == 0) {
+            JWLogError << "IDR(s): breakdown after " << iterations
+                       << " iterations" << endLog;
+            break;
+        }
+
+        omega = products[0] / products[1];
+        auto angle =
+            std::abs(products[0]) / (std::sqrt(products[1]) * rhos.back());
+        if (angle < kappa) {
+            omega *= kappa / angle;
+        }
+
+        if (omega == 0) {
+            JWLogError << "IDR(s): stagnation after " << iterations
+                       << " iterations" << endLog;
+            break;
+        }
+
+        Zee::axpby(-omega, t, (TVal)1, r);
+        Zee::axpby(omega, vHat, (TVal)1, x);
+        statistics.lap(phase::vector_update);
+
+        addResidual();
+        statistics.addIteration(rhos.back());
+    }
+
+    statistics.finish();
+
+    return rhos;
+}
+
+/** Solve Ax = b using the right-preconditioned IDR(s) method with
+ * preconditioner M.
+ * @return the residual norm before the first SpMV, and after each SpMV */
+template <typename TVal, typename TIdx, class TPreconditioner>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx s,
+                        const TPreconditioner& M, TIdx max_iterations,
+                        TVal tol, bool plotResiduals = false,
+                        bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solve(A, b, x, s, M, max_iterations, tol, statistics);
+
+    if (benchmark) statistics.report("IDR(s)");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto plot = Zee::Plotter<TVal>();
+        plot["xlabel"] = "iterations";
+        plot["ylabel"] = "$\\|r\\|$";
+        plot["yscale"] = "log";
+        plot["title"] = "IDR(s): residual norm";
+        plot.addLine(rhos, "rhos");
+        plot.plot("residual_test_idrs", true);
+    }
+
+    return rhos;
+}
+
+/** Solve Ax = b using the unpreconditioned IDR(s) method, recording the solve
+ * in `statistics` */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx s,
+                        TIdx max_iterations, TVal tol,
+                        SolverStatistics<TVal>& statistics) {
+    return solve(A, b, x, s, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, statistics);
+}
+
+/** Solve Ax = b using the unpreconditioned IDR(s) method */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(Zee::DSparseMatrix<TVal, TIdx>& A,
+                        const Zee::DVector<TVal, TIdx>& b,
+                        Zee::DVector<TVal, TIdx>& x, TIdx s,
+                        TIdx max_iterations, TVal tol,
+                        bool plotResiduals = false, bool benchmark = false) {
+    return solve(A, b, x, s, IdentityPreconditioner<TVal, TIdx>(),
+                 max_iterations, tol, plotResiduals, benchmark);
+}
+
+}  // namespace IDR
+
+}  // namespace Zee
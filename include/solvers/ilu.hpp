@@ -0,0 +1,212 @@
+/*
+File: include/solvers/ilu.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "../matrix/sparse/sparse.hpp"
+#include "triangular.hpp"
+
+namespace Zee {
+
+/** The ordering of the unknowns in an incomplete factorization */
+enum class ilu_ordering {
+    /** The given order */
+    natural,
+    /** Reorder by the colors of a greedy coloring of the matrix graph. The
+     * triangular solves then have one level per color, which exposes much
+     * more parallelism, at the price of a different (often somewhat weaker)
+     * factorization. */
+    multicolor
+};
+
+namespace detail {
+
+/** An incomplete LU factorization without fill-in, ILU(0), of a small sparse
+ * matrix that is held by a single worker, such as the diagonal block of an
+ * image. The factors L (with unit diagonal) and U are stored together in
+ * compressed rows, with the sparsity pattern of the original matrix.
+ *
+ * The triangular solves use level schedules that are built once, after the
+ * factorization, such that the rows within a level are solved in
+ * parallel. */
+template <typename TVal, typename TIdx>
+class SparseILU0 {
+   public:
+    /** Factor the n x n matrix with the given (local) entries. Duplicate
+     * entries are summed, and missing diagonal entries are added. */
+    void factor(TIdx n, std::vector<Triplet<TVal, TIdx>> entries,
+                ilu_ordering ordering = ilu_ordering::natural) {
+        n_ = n;
+        zeroPivots_ = 0;
+
+        permutation_.clear();
+        if (ordering == ilu_ordering::multicolor) {
+            // sort the indices by color, and renumber the entries
+            auto color = greedyColoring(n, entries);
+            permutation_.resize(n);
+            for (TIdx i = 0; i < n; ++i) {
+                permutation_[i] = i;
+            }
+            std::stable_sort(
+                permutation_.begin(), permutation_.end(),
+                [&](TIdx a, TIdx b) { return color[a] < color[b]; });
+
+            std::vector<TIdx> inverse(n);
+            for (TIdx k = 0; k < n; ++k) {
+                inverse[permutation_[k]] = k;
+            }
+            for (auto& entry : entries) {
+                entry.setRow(inverse[entry.row()]);
+                entry.setCol(inverse[entry.col()]);
+            }
+        }
+
+        for (TIdx i = 0; i < n; ++i) {
+            entries.push_back(Triplet<TVal, TIdx>(i, i, 0));
+        }
+        std::sort(entries.begin(), entries.end());
+
+        // compressed rows, summing duplicates
+        rowStart_.assign(n + 1, 0);
+        cols_.clear();
+        values_.clear();
+        const Triplet<TVal, TIdx>* previous = nullptr;
+        for (auto& entry : entries) {
+            JWAssert(entry.row() < n && entry.col() < n);
+            if (previous && *previous == entry) {
+                values_.back() += entry.value();
+                continue;
+            }
+            cols_.push_back(entry.col());
+            values_.push_back(entry.value());
+            rowStart_[entry.row() + 1]++;
+            previous = &entry;
+        }
+        for (TIdx i = 0; i < n; ++i) {
+            rowStart_[i + 1] += rowStart_[i];
+        }
+
+        diagonal_.resize(n);
+        for (TIdx i = 0; i < n; ++i) {
+            diagonal_[i] =
+                std::lower_bound(cols_.begin() + rowStart_[i],
+                                 cols_.begin() + rowStart_[i + 1], i) -
+                cols_.begin();
+        }
+
+        // the IKJ variant of Gaussian elimination, restricted to the pattern
+        const auto none = (TIdx)-1;
+        std::vector<TIdx> position(n, none);
+        for (TIdx i = 0; i < n; ++i) {
+            for (auto p = rowStart_[i]; p < rowStart_[i + 1]; ++p) {
+                position[cols_[p]] = p;
+            }
+
+            for (auto p = rowStart_[i]; p < diagonal_[i]; ++p) {
+                auto k = cols_[p];
+                values_[p] /= values_[diagonal_[k]];
+                for (auto q = diagonal_[k] + 1; q < rowStart_[k + 1]; ++q) {
+                    if (position[cols_[q]] != none) {
+                        values_[position[cols_[q]]] -= values_[p] * values_[q];
+                    }
+                }
+            }
+
+            if (values_[diagonal_[i]] == 0) {
+                zeroPivots_++;
+                values_[diagonal_[i]] = 1;
+            }
+
+            for (auto p = rowStart_[i]; p < rowStart_[i + 1]; ++p) {
+                position[cols_[p]] = none;
+            }
+        }
+
+        lower_.build(n, rowStart_, cols_, diagonal_, true);
+        upper_.build(n, rowStart_, cols_, diagonal_, false);
+    }
+
+    /** Computes \f$x = (LU)^{-1} x\f$ in place, using the given number of
+     * threads for the triangular solves */
+    void solve(TVal* x, std::size_t threads = 1) const {
+        if (!permutation_.empty()) {
+            std::vector<TVal> permuted(n_);
+            for (TIdx k = 0; k < n_; ++k) {
+                permuted[k] = x[permutation_[k]];
+            }
+            solve_(permuted.data(), threads);
+            for (TIdx k = 0; k < n_; ++k) {
+                x[permutation_[k]] = permuted[k];
+            }
+            return;
+        }
+
+        solve_(x, threads);
+    }
+
+    /** @return the dimension of the factored matrix */
+    TIdx size() const { return n_; }
+
+    /** @return the number of non-zeros in the factors */
+    TIdx nonZeros() const { return values_.size(); }
+
+    /** @return the number of zero pivots that were replaced by one */
+    TIdx zeroPivots() const { return zeroPivots_; }
+
+    /** @return the number of levels of the solves with L and U */
+    std::size_t lowerLevels() const { return lower_.levels(); }
+    std::size_t upperLevels() const { return upper_.levels(); }
+
+   private:
+    void solve_(TVal* x, std::size_t threads) const {
+        lower_.run(
+            [&](TIdx i) {
+                auto sum = x[i];
+                for (auto p = rowStart_[i]; p < diagonal_[i]; ++p) {
+                    sum -= values_[p] * x[cols_[p]];
+                }
+                x[i] = sum;
+            },
+            threads);
+
+        upper_.run(
+            [&](TIdx i) {
+                auto sum = x[i];
+                for (auto p = diagonal_[i] + 1; p < rowStart_[i + 1]; ++p) {
+                    sum -= values_[p] * x[cols_[p]];
+                }
+                x[i] = sum / values_[diagonal_[i]];
+            },
+            threads);
+    }
+
+    TIdx n_ = 0;
+    TIdx zeroPivots_ = 0;
+    std::vector<TIdx> rowStart_;
+    std::vector<TIdx> cols_;
+    std::vector<TIdx> diagonal_;
+    std::vector<TVal> values_;
+
+    // the new order of the unknowns, empty for the natural ordering
+    std::vector<TIdx> permutation_;
+
+    LevelSchedule<TIdx> lower_;
+    LevelSchedule<TIdx> upper_;
+};
+
+}  // namespace detail
+
+}  // namespace Zee
@@ -0,0 +1,132 @@
+/*
+File: include/solvers/mixed_precision.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace Zee {
+
+namespace IterativeRefinement {
+
+/** A refinement step is considered to stall if it does not reduce the
+ * residual by at least this factor */
+constexpr double stall_factor = 0.5;
+
+/** Solve Ax = b to high precision (THigh) with low-precision (TLow) GMRES
+ * solves, using iterative refinement.
+ *
+ * Every refinement step computes the residual \f$r = b - Ax\f$ in high
+ * precision. The correction equation \f$A d = r\f$ is solved with
+ * `GMRES::solve` on `lowA`, the matrix values and vectors of which are in low
+ * precision, and the correction is added to x in high precision. The
+ * right-hand side of the correction equation is scaled to unit norm, such that
+ * the low-precision solve does not underflow as the residual decreases.
+ *
+ * Since the SpMVs and vector updates of GMRES are bound by memory bandwidth,
+ * the inner solves run at close to the cost of a low-precision solve, while
+ * the result is accurate in high precision. If a refinement step stalls, for
+ * instance because A is too ill-conditioned for the low precision, the
+ * driver falls back to solving the correction equation with GMRES in high
+ * precision.
+ *
+ * @param lowA a copy of A in low precision with the same distribution, see
+ * `convertValues`
+ * @param inner_tol the tolerance of the (scaled) low-precision solves
+ * @return the residual norm after each refinement step */
+template <typename THigh, typename TLow, typename TIdx>
+std::vector<THigh> solve(Zee::DSparseMatrix<THigh, TIdx>& A,
+                         Zee::DSparseMatrix<TLow, TIdx>& lowA,
+                         const Zee::DVector<THigh, TIdx>& b,
+                         Zee::DVector<THigh, TIdx>& x, TIdx refinements,
+                         TIdx outer_iterations, TIdx inner_iterations,
+                         THigh tol, TLow inner_tol = 1e-4,
+                         bool benchmark = false) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (mixed precision)" << endLog;
+
+    JWAssert(A.getRows() == lowA.getRows());
+    JWAssert(A.getCols() == lowA.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    auto bench = Zee::Benchmark("Mixed-precision refinement");
+    if (!benchmark) bench.silence();
+
+    auto n = A.getRows();
+
+    Zee::DVector<THigh, TIdx> r(n);
+    Zee::DVector<THigh, TIdx> correction(n);
+    Zee::DVector<TLow, TIdx> lowR(n);
+    Zee::DVector<TLow, TIdx> lowCorrection(n);
+
+    std::vector<THigh> residuals;
+    residuals.push_back(residual(A, x, b, r));
+
+    for (TIdx k = 0; k < refinements && residuals.back() >= tol; ++k) {
+        auto scale = residuals.back();
+
+        // the scaled residual in low precision
+        {
+            const auto* rs = r.data();
+            auto* lows = lowR.data();
+            detail::elementwise(n, [=](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    lows[i] = (TLow)(rs[i] / scale);
+                }
+            });
+        }
+
+        lowCorrection.reset();
+        GMRES::solve(lowA, lowR, lowCorrection, outer_iterations,
+                     inner_iterations, inner_tol);
+
+        // x = x + scale * d in high precision
+        {
+            const auto* lows = lowCorrection.data();
+            auto* xs = x.data();
+            detail::elementwise(n, [=](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i) {
+                    xs[i] += scale * (THigh)lows[i];
+                }
+            });
+        }
+
+        residuals.push_back(residual(A, x, b, r));
+
+        if (residuals.back() > stall_factor * scale) {
+            JWLogInfo << "Mixed-precision refinement stalled after " << k + 1
+                      << " step(s), falling back to high precision" << endLog;
+
+            correction.reset();
+            GMRES::solve(A, r, correction, outer_iterations, inner_iterations,
+                         tol);
+            Zee::axpby((THigh)1, correction, (THigh)1, x);
+
+            residuals.push_back(residual(A, x, b, r));
+            break;
+        }
+    }
+
+    if (benchmark) bench.finish();
+
+    return residuals;
+}
+
+}  // namespace IterativeRefinement
+
+}  // namespace Zee
@@ -0,0 +1,236 @@
+/*
+File: include/solvers/pagerank.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "../matrix/dense/dense.hpp"
+#include "../matrix/sparse/sparse.hpp"
+#include "preconditioners.hpp"
+
+namespace Zee {
+
+/** The iteration used to compute a PageRank vector */
+enum class pagerank_method {
+    /** The power method, which takes an SpMV with \f$A^T\f$ per iteration */
+    power,
+    /** Gauss-Seidel sweeps per image. Every image updates its nodes in
+     * place, using the newest ranks of its own nodes and the ranks of the
+     * previous iteration for the nodes of other images, so that the images
+     * do not wait for each other during a sweep. The fewer links cross
+     * images, the closer this is to a global Gauss-Seidel sweep. */
+    gauss_seidel
+};
+
+namespace detail {
+
+/** What PageRank derives from the link matrix once: the nodes owned by every
+ * image, the dangling nodes (without out-links) among them, the inverse
+ * out-degrees, and for Gauss-Seidel the in-links of every node, weighted by
+ * the inverse out-degree of their source. */
+template <typename TVal, typename TIdx>
+struct PageRankGraph {
+    PageRankGraph(const DSparseMatrix<TVal, TIdx>& A, bool inLinks)
+        : owners(A.getRows(), 0),
+          owned(A.getProcs()),
+          dangling(A.getProcs()),
+          inverseDegree(A.getRows(), 0) {
+        auto n = A.getRows();
+        auto& images = A.getImages();
+
+        for (TIdx s = 0; s < images.size(); ++s) {
+            auto& indices = images[s]->getLocalIndicesU();
+            owned[s].assign(indices.begin(),
+                            indices.begin() + images[s]->getNumLocalU());
+            for (auto i : owned[s]) {
+                owners[i] = s;
+            }
+        }
+
+        auto forEachLink = [&](auto func) {
+            for (auto& image : images) {
+                for (const auto& triplet : *image) {
+                    func(image->getLocalIndicesU()[triplet.row()],
+                         image->getLocalIndicesV()[triplet.col()],
+                         triplet.value());
+                }
+            }
+        };
+
+        std::vector<double> degree(n, 0);
+        forEachLink([&](TIdx i, TIdx, TVal value) { degree[i] += value; });
+        for (TIdx i = 0; i < n; ++i) {
+            if (degree[i] != 0) inverseDegree[i] = (TVal)(1 / degree[i]);
+        }
+        for (TIdx s = 0; s < images.size(); ++s) {
+            for (auto i : owned[s]) {
+                if (degree[i] == 0) dangling[s].push_back(i);
+            }
+        }
+
+        if (!inLinks) return;
+
+        start.assign(n + 1, 0);
+        forEachLink([&](TIdx, TIdx j, TVal) { start[j + 1]++; });
+        for (TIdx j = 0; j < n; ++j) {
+            start[j + 1] += start[j];
+        }
+        sources.resize(start[n]);
+        weights.resize(start[n]);
+        auto next = start;
+        forEachLink([&](TIdx i, TIdx j, TVal value) {
+            auto k = next[j]++;
+            sources[k] = i;
+            weights[k] = value * inverseDegree[i];
+        });
+    }
+
+    std::vector<TIdx> owners;
+    std::vector<std::vector<TIdx>> owned;
+    std::vector<std::vector<TIdx>> dangling;
+    std::vector<TVal> inverseDegree;
+
+    std::vector<TIdx> start;
+    std::vector<TIdx> sources;
+    std::vector<TVal> weights;
+};
+
+}  // namespace detail
+
+namespace PageRank {
+
+/** Computes the PageRank vector x of the graph with link matrix A, where
+ * \f$a_{ij}\f$ is the weight of the link from node i to node j, i.e. the
+ * stationary distribution of the random surfer who follows a link with
+ * probability `damping`, and jumps to a random node otherwise. It satisfies
+ * \f[ x = \alpha P^T x + \frac{\alpha d^T x + (1 - \alpha)}{n} e, \f]
+ * where P is A scaled to unit row sums, and d indicates the dangling nodes.
+ * The dangling nodes are not given links to all nodes; instead, their total
+ * rank, a sum over a sparse set of nodes, is spread as a constant.
+ *
+ * The iterations use the partitioning of A, which has to be localized with
+ * the same distribution for u and v: every image updates the ranks of its
+ * nodes, and sums their change, their total rank and that of its dangling
+ * nodes. These three sums are combined in a single reduction per iteration,
+ * which gives the shift of the next iteration as well. The iteration stops
+ * when the change in the 1-norm, relative to the total rank, falls below
+ * tol.
+ *
+ * @return the change of x in each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solve(DSparseMatrix<TVal, TIdx>& A, DVector<TVal, TIdx>& x,
+                        TVal damping, TIdx max_iterations, TVal tol,
+                        pagerank_method method = pagerank_method::power) {
+    JWLogInfo << "Computing the PageRank of a graph with " << A.getRows()
+              << " nodes and " << A.nonZeros() << " links"
+              << ((method == pagerank_method::power) ? " (power method)"
+                                                     : " (Gauss-Seidel)")
+              << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == x.size());
+    JWAssert(A.localizedStorage());
+
+    using TVector = DVector<TVal, TIdx>;
+    using TSums = std::array<double, 3>;
+
+    auto n = A.getRows();
+    auto p = A.getProcs();
+    detail::PageRankGraph<TVal, TIdx> graph(
+        A, method == pagerank_method::gauss_seidel);
+
+    // every image computes the change, the dangling rank and the total rank
+    // of its nodes, which are combined in image order, so that the result
+    // does not depend on the scheduling of the images
+    std::vector<TSums> contributions(p);
+    auto reduce = [&](auto update) {
+        detail::forEachBlock(p, [&](std::size_t s) {
+            TSums sums = {0, 0, 0};
+            for (auto i : graph.owned[s]) {
+                auto rank = update(s, i);
+                sums[0] += std::abs(rank - x[i]);
+                sums[2] += rank;
+                x[i] = rank;
+            }
+            for (auto i : graph.dangling[s]) {
+                sums[1] += x[i];
+            }
+            contributions[s] = sums;
+        });
+
+        TSums sums = {0, 0, 0};
+        for (auto& contribution : contributions) {
+            for (std::size_t l = 0; l < sums.size(); ++l) {
+                sums[l] += contribution[l];
+            }
+        }
+        return sums;
+    };
+
+    auto sums = reduce([n](std::size_t, TIdx) { return (TVal)1 / n; });
+
+    TVector y(n);
+    TVector z(n);
+    TVector previous(n);
+    std::vector<TVal> changes;
+    for (TIdx iteration = 0; iteration < max_iterations; ++iteration) {
+        auto shift =
+            (TVal)((damping * sums[1] + (1 - damping) * sums[2]) / n);
+
+        if (method == pagerank_method::power) {
+            // z = A^T D^{-1} x
+            detail::forEachBlock(p, [&](std::size_t s) {
+                for (auto i : graph.owned[s]) {
+                    y[i] = x[i] * graph.inverseDegree[i];
+                }
+            });
+            multiplyTransposed(A, y, z);
+
+            sums = reduce([&](std::size_t, TIdx i) {
+                return damping * z[i] + shift;
+            });
+        } else {
+            copy(x, previous);
+
+            sums = reduce([&](std::size_t s, TIdx i) {
+                TVal sum = 0;
+                TVal self = 0;
+                for (auto k = graph.start[i]; k < graph.start[i + 1]; ++k) {
+                    auto j = graph.sources[k];
+                    if (j == i) {
+                        self += graph.weights[k];
+                    } else {
+                        auto rank = (graph.owners[j] == s) ? x[j] : previous[j];
+                        sum += graph.weights[k] * rank;
+                    }
+                }
+                return (damping * sum + shift) / (1 - damping * self);
+            });
+        }
+
+        changes.push_back((TVal)(sums[0] / sums[2]));
+        if (changes.back() < tol) break;
+    }
+
+    // a probability distribution
+    scale((TVal)(1 / sums[2]), x);
+
+    return changes;
+}
+
+}  // namespace PageRank
+
+}  // namespace Zee
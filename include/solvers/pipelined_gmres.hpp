@@ -0,0 +1,245 @@
+/*
+File: include/solvers/pipelined_gmres.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <future>
+#include <limits>
+#include <vector>
+
+#include "hessenberg.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace GMRES {
+
+/** Solve Ax = b using pipelined GMRES(m), with m = inner_iterations.
+ *
+ * This is p(1)-GMRES: every iteration needs a single global reduction, which
+ * computes the Hessenberg coefficients \f$h_{j, i} = \langle v_j, w \rangle\f$
+ * together with \f$\langle w, w \rangle\f$. The reduction runs concurrently
+ * with the SpMV \f$q = A w\f$ for the next iteration. Besides the basis V we
+ * keep \f$Z = AV\f$, and the next column of Z follows from q by the recurrence
+ * \f[ z_{i + 1} = (q - \sum_{j \leq i} h_{j, i} z_j) / h_{i + 1, i}. \f]
+ *
+ * The norm \f$h_{i + 1, i}\f$ is obtained as
+ * \f$\sqrt{\langle w, w \rangle - \sum_j h_{j, i}^2}\f$. When this loses
+ * too many digits to cancellation, the iteration falls back to an explicit
+ * reorthogonalization and norm, and recomputes the next column of Z with an
+ * SpMV. This costs the overlap for that iteration only.
+ *
+ * The solve is recorded in `statistics`. The reduction of an iteration is
+ * hidden behind its SpMV, so their time is counted as SpMV time.
+ * @return the residual norm estimate after each iteration, which can be
+ * compared with the history returned by `solve`. */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solvePipelined(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                 const Zee::DVector<TVal, TIdx>& b,
+                                 Zee::DVector<TVal, TIdx>& x,
+                                 TIdx outer_iterations, TIdx inner_iterations,
+                                 TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (pipelined)" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+    auto m = std::min(n, inner_iterations);
+
+    statistics.start();
+
+    // the basis V of the Krylov subspace, and Z = AV
+    std::vector<TVector> V(m + 1, TVector(n));
+    std::vector<TVector> Z(m + 1, TVector(n));
+
+    // the SpMV of the iteration ahead
+    TVector q(n);
+
+    // the current column of the Hessenberg matrix, followed by <w, w>
+    std::vector<TVal> h(m + 2);
+    std::vector<TVal> correction(m);
+
+    // the columns of V are only written in place, so their storage is fixed
+    std::vector<const TVal*> basis(m + 2);
+    for (TIdx j = 0; j <= m; ++j) {
+        basis[j] = V[j].data();
+    }
+
+    detail::HessenbergLeastSquares<TVal> leastSquares(m);
+
+    // below this fraction of <w, w> the norm is computed explicitly
+    const auto cancellation = std::sqrt(std::numeric_limits<TVal>::epsilon());
+
+    TIdx restabilizations = 0;
+    statistics.lap(phase::other);
+
+    // the residual and its norm are computed in a single sweep
+    TVector r(n);
+    auto beta = residual(A, x, b, r);
+    statistics.countSpMV();
+    statistics.countReduction();
+    statistics.lap(phase::spmv);
+
+    auto finished = false;
+    for (TIdx run = 0; run < outer_iterations && !finished; ++run) {
+        if (run > 0) statistics.countRestart();
+        if (beta < tol) break;
+
+        Zee::scale((TVal)1 / beta, r, V[0]);
+        leastSquares.reset(beta);
+        statistics.lap(phase::vector_update);
+        Z[0] = A * V[0];
+        statistics.countSpMV();
+        statistics.lap(phase::spmv);
+
+        for (TIdx i = 0; i < m; ++i) {
+            auto& w = Z[i];
+            auto& v = V[i + 1];
+            auto lookahead = (i + 1 < m);
+
+            // one reduction for the projections and the norm of w, which
+            // overlaps with the SpMV for the next iteration
+            basis[i + 1] = w.data();
+            auto reduction = std::async(std::launch::async, [&] {
+                detail::multiDot<TVal>(n, basis.data(), i + 2, w.data(),
+                                       h.data());
+            });
+            if (lookahead) q = A * w;
+            reduction.get();
+            basis[i + 1] = v.data();
+            if (lookahead) statistics.countSpMV();
+            statistics.countReduction(i + 2);
+            statistics.lap(phase::spmv);
+
+            auto squaredNorm = h[i + 1];
+            for (TIdx j = 0; j <= i; ++j) {
+                squaredNorm -= h[j] * h[j];
+            }
+
+            Zee::copy(w, v);
+            detail::multiAxpy<TVal>(n, (TVal)-1, basis.data(), i + 1,
+                                    h.data(), v.data());
+
+            auto stable = squaredNorm > cancellation * h[i + 1];
+            if (stable) {
+                h[i + 1] = std::sqrt(squaredNorm);
+            } else {
+                detail::multiDot<TVal>(n, basis.data(), i + 1, v.data(),
+                                       correction.data());
+                detail::multiAxpy<TVal>(n, (TVal)-1, basis.data(), i + 1,
+                                        correction.data(), v.data());
+                for (TIdx j = 0; j <= i; ++j) {
+                    h[j] += correction[j];
+                }
+                h[i + 1] = v.norm();
+                statistics.countReduction(i + 1);
+                statistics.countReduction();
+                restabilizations++;
+            }
+            statistics.lap(phase::orthogonalization);
+
+            auto rho = leastSquares.addColumn(h.data());
+            statistics.addIteration(rho);
+
+            if (rho < tol || h[i + 1] == 0) {
+                finished = true;
+                break;
+            }
+
+            Zee::scale((TVal)1 / h[i + 1], v);
+            statistics.lap(phase::vector_update);
+
+            if (!lookahead) continue;
+
+            if (stable) {
+                auto products = detail::columnPointers(Z, i + 1);
+                Zee::copy(q, Z[i + 1]);
+                detail::multiAxpy<TVal>(n, (TVal)-1, products.data(), i + 1,
+                                        h.data(), Z[i + 1].data());
+                Zee::scale((TVal)1 / h[i + 1], Z[i + 1]);
+                statistics.lap(phase::vector_update);
+            } else {
+                Z[i + 1] = A * v;
+                statistics.countSpMV();
+                statistics.lap(phase::spmv);
+            }
+        }
+
+        auto y = leastSquares.solve();
+        statistics.lap(phase::other);
+        detail::multiAxpy<TVal>(n, (TVal)1, basis.data(), y.size(), y.data(),
+                                x.data());
+        statistics.lap(phase::vector_update);
+
+        beta = residual(A, x, b, r);
+        statistics.countSpMV();
+        statistics.countReduction();
+        statistics.lap(phase::spmv);
+    }
+
+    if (restabilizations > 0) {
+        JWLogInfo << "Pipelined GMRES computed " << restabilizations
+                  << " norm(s) explicitly" << endLog;
+    }
+
+    statistics.finish();
+
+    return statistics.getResiduals();
+}
+
+/** Solve Ax = b using pipelined GMRES(m), with m = inner_iterations.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solvePipelined(Zee::DSparseMatrix<TVal, TIdx>& A,
+                                 const Zee::DVector<TVal, TIdx>& b,
+                                 Zee::DVector<TVal, TIdx>& x,
+                                 TIdx outer_iterations, TIdx inner_iterations,
+                                 TVal tol, bool plotResiduals = false,
+                                 bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solvePipelined(A, b, x, outer_iterations, inner_iterations,
+                               tol, statistics);
+
+    if (benchmark) statistics.report("pipelined GMRES");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto p = Zee::Plotter<TVal>();
+        p["xlabel"] = "iterations";
+        p["ylabel"] = "$\\rho$";
+        p["yscale"] = "log";
+        p["title"] = "Pipelined GMRES: residual norm";
+        p.addLine(rhos, "rhos");
+        p.plot("residual_test_pipelined", true);
+    }
+
+    return rhos;
+}
+
+}  // namespace GMRES
+
+}  // namespace Zee
@@ -0,0 +1,312 @@
+/*
+File: include/solvers/preconditioners.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../matrix/dense/dense.hpp"
+#include "../matrix/sparse/overlap.hpp"
+#include "../matrix/sparse/sparse.hpp"
+#include "../util/parallel.hpp"
+#include "ilu.hpp"
+
+namespace Zee {
+
+// A preconditioner M approximates A, and is applied to a residual by
+// `apply(r, z)`, which computes z = M^{-1} r. The solvers take the
+// preconditioner as a template argument, so any class with this member
+// can be used.
+
+namespace detail {
+
+// Calls func(s) for s in [0, blocks), one thread per block
+template <typename TFunc>
+void forEachBlock(std::size_t blocks, TFunc func) {
+    std::vector<std::thread> threads;
+    for (std::size_t s = 1; s < blocks; ++s) {
+        threads.push_back(std::thread(func, s));
+    }
+    if (blocks > 0) func(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// The kernel threads that are available to each of the blocks
+inline std::size_t threadsPerBlock(std::size_t blocks) {
+    return std::max(kernelThreads() / std::max(blocks, (std::size_t)1),
+                    (std::size_t)1);
+}
+
+}  // namespace detail
+
+/** The trivial preconditioner M = I */
+template <typename TVal, typename TIdx>
+class IdentityPreconditioner {
+   public:
+    void apply(const DVector<TVal, TIdx>& r, DVector<TVal, TIdx>& z) const {
+        copy(r, z);
+    }
+};
+
+namespace detail {
+
+/** @return the inverse of the diagonal of A, where a zero on the diagonal is
+ * replaced by one */
+template <typename TVal, typename TIdx>
+DVector<TVal, TIdx> inverseDiagonal(const DSparseMatrix<TVal, TIdx>& A,
+                                    std::string name) {
+    JWAssert(A.getRows() == A.getCols());
+
+    DVector<TVal, TIdx> inverse(A.getRows(), 0);
+    for (auto& image : A.getImages()) {
+        auto localized = image->localizedStorage();
+        for (const auto& triplet : *image) {
+            auto row = localized ? image->getLocalIndicesU()[triplet.row()]
+                                 : triplet.row();
+            auto col = localized ? image->getLocalIndicesV()[triplet.col()]
+                                 : triplet.col();
+            if (row == col) inverse[row] += triplet.value();
+        }
+    }
+
+    for (TIdx i = 0; i < inverse.size(); ++i) {
+        if (inverse[i] == 0) {
+            JWLogError << name << ": zero on the diagonal in row " << i
+                       << endLog;
+            inverse[i] = 1;
+        }
+        inverse[i] = 1 / inverse[i];
+    }
+
+    return inverse;
+}
+
+}  // namespace detail
+
+/** The Jacobi preconditioner M = diag(A) */
+template <typename TVal, typename TIdx>
+class JacobiPreconditioner {
+   public:
+    explicit JacobiPreconditioner(const DSparseMatrix<TVal, TIdx>& A)
+        : inverseDiagonal_(
+              detail::inverseDiagonal(A, "Jacobi preconditioner")) {}
+
+    void apply(const DVector<TVal, TIdx>& r, DVector<TVal, TIdx>& z) const {
+        JWAssert(r.size() == inverseDiagonal_.size());
+        JWAssert(z.size() == inverseDiagonal_.size());
+
+        const auto* d = inverseDiagonal_.data();
+        const auto* rs = r.data();
+        auto* zs = z.data();
+        detail::elementwise(z.size(), [=](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                zs[i] = d[i] * rs[i];
+            }
+        });
+    }
+
+   private:
+    DVector<TVal, TIdx> inverseDiagonal_;
+};
+
+/** The block-Jacobi preconditioner. The blocks are the subdomains of the
+ * images: block s is the submatrix of A with the rows and columns owned by
+ * image s, which is factored with ILU(0). Every image assembles its block
+ * from the rows it owns, see `OwnedRows`, so that no image needs the entries
+ * of all of A. The factorizations and the solves are done in parallel, one
+ * thread per block, and the level-scheduled triangular solves of a block
+ * share the remaining kernel threads. The unknowns of a block can be
+ * reordered by color to shorten these schedules, see `ilu_ordering`. Since
+ * every block only reads and writes the vector components owned by its
+ * image, applying the preconditioner needs no communication.
+ *
+ * A has to be localized with dist(u) = dist(v), as is done by the
+ * `GreedyVectorPartitioner` for square matrices. */
+template <typename TVal, typename TIdx>
+class BlockJacobiPreconditioner {
+   public:
+    explicit BlockJacobiPreconditioner(
+        const DSparseMatrix<TVal, TIdx>& A,
+        ilu_ordering ordering = ilu_ordering::natural)
+        : n_(A.getRows()) {
+        JWAssert(A.getRows() == A.getCols());
+        JWAssert(A.localizedStorage());
+
+        auto p = A.getProcs();
+        detail::OwnedRows<TVal, TIdx> rows(A);
+
+        indices_.resize(p);
+        blocks_.resize(p);
+        std::vector<TIdx> zeroPivots(p);
+        detail::forEachBlock(p, [&](std::size_t s) {
+            auto domain = rows.extend(s, 0);
+
+            // the entries of the owned rows in owned columns, which the image
+            // holds after the entries stored elsewhere were sent to it
+            std::vector<Triplet<TVal, TIdx>> entries;
+            for (TIdx l = 0; l < domain.indices.size(); ++l) {
+                auto range = rows.row(s, domain.indices[l]);
+                for (auto entry = range.first; entry != range.second;
+                     ++entry) {
+                    if (entry->owner != s) continue;
+                    entries.push_back(Triplet<TVal, TIdx>(
+                        l, domain.position[entry->col], entry->value));
+                }
+            }
+
+            indices_[s] = std::move(domain.indices);
+            blocks_[s].factor(indices_[s].size(), std::move(entries),
+                              ordering);
+            zeroPivots[s] = blocks_[s].zeroPivots();
+        });
+
+        for (auto count : zeroPivots) {
+            if (count > 0) {
+                JWLogError << "Block-Jacobi preconditioner: " << count
+                           << " zero pivot(s) replaced by one" << endLog;
+            }
+        }
+    }
+
+    void apply(const DVector<TVal, TIdx>& r, DVector<TVal, TIdx>& z) const {
+        JWAssert(r.size() == n_);
+        JWAssert(z.size() == n_);
+
+        auto threads = detail::threadsPerBlock(blocks_.size());
+        detail::forEachBlock(blocks_.size(), [&](std::size_t s) {
+            auto& indices = indices_[s];
+            std::vector<TVal> local(indices.size());
+            for (std::size_t l = 0; l < indices.size(); ++l) {
+                local[l] = r[indices[l]];
+            }
+
+            blocks_[s].solve(local.data(), threads);
+
+            for (std::size_t l = 0; l < indices.size(); ++l) {
+                z[indices[l]] = local[l];
+            }
+        });
+    }
+
+    /** @return the number of blocks */
+    std::size_t getBlocks() const { return blocks_.size(); }
+
+   private:
+    TIdx n_;
+    std::vector<std::vector<TIdx>> indices_;
+    std::vector<detail::SparseILU0<TVal, TIdx>> blocks_;
+};
+
+/** The restricted additive Schwarz (RAS) preconditioner. The subdomain of
+ * image s, the indices it owns, is extended by `overlap` layers of
+ * neighbouring indices in the graph of A. The first layer consists of the
+ * remote column indices of the image, i.e. the ghost components that it
+ * receives in an SpMV, and every image finds the further layers in the rows of
+ * their owners, see `OwnedRows`.
+ *
+ * The matrices of the extended subdomains are factored with ILU(0), and are
+ * applied in parallel. Due to the restriction every subdomain only writes the
+ * components that it owns, so that the overlap only requires the ghost layers
+ * of the residual to be read. Without overlap this is block Jacobi. */
+template <typename TVal, typename TIdx>
+class AdditiveSchwarzPreconditioner {
+   public:
+    explicit AdditiveSchwarzPreconditioner(
+        const DSparseMatrix<TVal, TIdx>& A, TIdx overlap = 1,
+        ilu_ordering ordering = ilu_ordering::natural)
+        : n_(A.getRows()) {
+        JWAssert(A.getRows() == A.getCols());
+        JWAssert(A.localizedStorage());
+
+        auto p = A.getProcs();
+        detail::OwnedRows<TVal, TIdx> rows(A);
+
+        indices_.resize(p);
+        owned_.resize(p);
+        blocks_.resize(p);
+        std::vector<TIdx> zeroPivots(p);
+        detail::forEachBlock(p, [&](std::size_t s) {
+            auto domain = rows.extend(s, overlap);
+
+            std::vector<Triplet<TVal, TIdx>> entries;
+            for (TIdx l = 0; l < domain.indices.size(); ++l) {
+                auto range = rows.row(domain.owners[l], domain.indices[l]);
+                for (auto entry = range.first; entry != range.second;
+                     ++entry) {
+                    auto target = domain.position.find(entry->col);
+                    if (target == domain.position.end()) continue;
+                    entries.push_back(
+                        Triplet<TVal, TIdx>(l, target->second, entry->value));
+                }
+            }
+
+            // the owned indices come first in every subdomain
+            indices_[s] = std::move(domain.indices);
+            owned_[s] = domain.layerEnd[0];
+
+            blocks_[s].factor(indices_[s].size(), std::move(entries),
+                              ordering);
+            zeroPivots[s] = blocks_[s].zeroPivots();
+        });
+
+        for (auto count : zeroPivots) {
+            if (count > 0) {
+                JWLogError << "Additive Schwarz preconditioner: " << count
+                           << " zero pivot(s) replaced by one" << endLog;
+            }
+        }
+    }
+
+    void apply(const DVector<TVal, TIdx>& r, DVector<TVal, TIdx>& z) const {
+        JWAssert(r.size() == n_);
+        JWAssert(z.size() == n_);
+        JWAssert(&r != &z);
+
+        auto threads = detail::threadsPerBlock(blocks_.size());
+        detail::forEachBlock(blocks_.size(), [&](std::size_t s) {
+            auto& indices = indices_[s];
+            std::vector<TVal> local(indices.size());
+            for (std::size_t l = 0; l < indices.size(); ++l) {
+                local[l] = r[indices[l]];
+            }
+
+            blocks_[s].solve(local.data(), threads);
+
+            // restriction: only the owned components are written
+            for (std::size_t l = 0; l < owned_[s]; ++l) {
+                z[indices[l]] = local[l];
+            }
+        });
+    }
+
+    /** @return the number of subdomains */
+    std::size_t getBlocks() const { return blocks_.size(); }
+
+    /** @return the size of the extended subdomain s */
+    TIdx getSubdomainSize(std::size_t s) const { return indices_[s].size(); }
+
+   private:
+    TIdx n_;
+    std::vector<std::vector<TIdx>> indices_;
+    std::vector<TIdx> owned_;
+    std::vector<detail::SparseILU0<TVal, TIdx>> blocks_;
+};
+
+}  // namespace Zee
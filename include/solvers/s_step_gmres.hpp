@@ -0,0 +1,264 @@
+/*
+File: include/solvers/s_step_gmres.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <zee.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "hessenberg.hpp"
+#include "statistics.hpp"
+
+namespace Zee {
+
+namespace GMRES {
+
+/** Solve Ax = b using s-step GMRES(m), with m = inner_iterations rounded up to
+ * a multiple of s.
+ *
+ * The Krylov basis is extended by s vectors at a time: the
+ * `MatrixPowers` kernel computes the monomial basis
+ * \f$[A v, A^2 v, \ldots, A^s v]\f$ for the last basis vector v with a single
+ * ghost exchange. The new vectors are orthogonalized as a block, by block
+ * CGS2 against the earlier basis followed by TSQR, which takes two block
+ * reductions and one TSQR reduction for every s steps. The projections and
+ * the triangular factor give each power p in the orthonormal basis,
+ * \f$p_k = \sum_i r_{i, k} v_i\f$, and since \f$A p_{k - 1} = p_k\f$ the
+ * columns of the Hessenberg matrix follow without further SpMVs.
+ *
+ * The monomial basis becomes ill-conditioned as s grows, so s should be
+ * small (say, at most 5 in single precision). If the powers become linearly
+ * dependent in working precision, the cycle is ended early and GMRES is
+ * restarted.
+ *
+ * The solve is recorded in `statistics`, where a matrix powers kernel counts
+ * as s SpMVs.
+ * @return the residual norm estimate after each iteration, which can be
+ * compared with the history returned by `solve`. */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveSStep(Zee::DSparseMatrix<TVal, TIdx>& A,
+                             const Zee::DVector<TVal, TIdx>& b,
+                             Zee::DVector<TVal, TIdx>& x, TIdx s,
+                             TIdx outer_iterations, TIdx inner_iterations,
+                             TVal tol, SolverStatistics<TVal>& statistics) {
+    JWLogInfo << "Solving Ax = b for system of size " << A.getRows() << " x "
+              << A.getCols() << " with " << A.nonZeros()
+              << " non-zeros (s-step, s = " << s << ")" << endLog;
+
+    JWAssert(A.getRows() == A.getCols());
+    JWAssert(A.getRows() == b.size());
+    JWAssert(A.getCols() == x.size());
+    JWAssert(s > 0);
+
+    using TVector = Zee::DVector<TVal, TIdx>;
+    using phase = solver_phase;
+
+    auto n = A.getRows();
+    auto m = std::min(n, inner_iterations);
+    m = ((m + s - 1) / s) * s;
+
+    statistics.start();
+
+    Zee::MatrixPowers<TVal, TIdx> powers(A, s);
+
+    // the basis V of the Krylov subspace, which is only written in place
+    std::vector<TVector> V(m + 1, TVector(n));
+    auto basis = detail::columnPointers(V, m + 1);
+
+    // the columns of the Hessenberg matrix, which are needed to express the
+    // products with the earlier basis vectors
+    std::vector<std::vector<TVal>> H(m, std::vector<TVal>(m + 1));
+    std::vector<TVal> h(m + 1);
+
+    // the coefficients of the current and the previous power in the basis
+    std::vector<TVal> coefficients(m + 1);
+    std::vector<TVal> previous(m + 1);
+
+    // the projections of the s new powers on the earlier basis, stored by
+    // columns, and the triangular factor of the orthogonalized powers
+    std::vector<TVal> projections(m * s);
+    std::vector<TVal> correction(m * s);
+    std::vector<TVal> R(s * s);
+    std::vector<TVal*> columnsP(s);
+
+    detail::HessenbergLeastSquares<TVal> leastSquares(m);
+
+    // below this fraction of its norm a power is considered dependent
+    const auto cancellation = std::sqrt(std::numeric_limits<TVal>::epsilon());
+
+    TIdx kernels = 0;
+    TIdx breakdowns = 0;
+    statistics.lap(phase::other);
+
+    // the residual and its norm are computed in a single sweep
+    TVector r(n);
+    auto beta = residual(A, x, b, r);
+    statistics.countSpMV();
+    statistics.countReduction();
+    statistics.lap(phase::spmv);
+
+    auto finished = false;
+    for (TIdx run = 0; run < outer_iterations && !finished; ++run) {
+        if (run > 0) statistics.countRestart();
+        if (beta < tol) break;
+
+        Zee::scale((TVal)1 / beta, r, V[0]);
+        leastSquares.reset(beta);
+        statistics.lap(phase::vector_update);
+
+        auto dependent = false;
+        for (TIdx start = 0; start < m && !finished && !dependent;
+             start += s) {
+            powers.apply(V[start], V, start + 1);
+            kernels++;
+            statistics.countSpMV(s);
+            statistics.lap(phase::spmv);
+
+            // block CGS2 of the powers against the earlier basis, and TSQR
+            // of the result, such that power k is given by the projections
+            // in column k - 1 and column k - 1 of R
+            auto earlier = start + 1;
+            for (TIdx k = 0; k < s; ++k) {
+                columnsP[k] = V[earlier + k].data();
+            }
+            detail::blockDot<TVal>(n, basis.data(), earlier, columnsP.data(),
+                                   s, projections.data());
+            detail::blockAxpy<TVal>(n, (TVal)-1, basis.data(), earlier,
+                                    projections.data(), columnsP.data(), s);
+            detail::blockDot<TVal>(n, basis.data(), earlier, columnsP.data(),
+                                   s, correction.data());
+            detail::blockAxpy<TVal>(n, (TVal)-1, basis.data(), earlier,
+                                    correction.data(), columnsP.data(), s);
+            for (std::size_t i = 0; i < earlier * s; ++i) {
+                projections[i] += correction[i];
+            }
+            detail::tsqr<TVal>(n, columnsP.data(), s, R.data());
+            statistics.countReduction(earlier * s);
+            statistics.countReduction(earlier * s);
+            statistics.countReduction(s * (s + 1) / 2);
+            statistics.lap(phase::orthogonalization);
+
+            // the first power is the basis vector itself
+            std::fill(previous.begin(), previous.end(), (TVal)0);
+            previous[start] = 1;
+
+            for (TIdx k = 1; k <= s; ++k) {
+                auto c = start + k;
+
+                // the coefficients of the power in the basis, where its norm
+                // before the orthogonalization follows from them
+                auto first = projections.begin() + (k - 1) * earlier;
+                std::copy(first, first + earlier, coefficients.begin());
+                std::copy(R.begin() + (k - 1) * s, R.begin() + (k - 1) * s + k,
+                          coefficients.begin() + earlier);
+                TVal squaredNorm = 0;
+                for (TIdx i = 0; i <= c; ++i) {
+                    squaredNorm += coefficients[i] * coefficients[i];
+                }
+
+                // column c - 1 of H, from A v_{c - 1} expressed in the powers
+                std::copy(coefficients.begin(), coefficients.begin() + c + 1,
+                          h.begin());
+                for (TIdx i = 0; i + 1 < c; ++i) {
+                    if (previous[i] == 0) continue;
+                    for (TIdx l = 0; l <= i + 1; ++l) {
+                        h[l] -= previous[i] * H[i][l];
+                    }
+                }
+                for (TIdx l = 0; l <= c; ++l) {
+                    h[l] /= previous[c - 1];
+                }
+                std::copy(h.begin(), h.begin() + c + 1, H[c - 1].begin());
+
+                auto rho = leastSquares.addColumn(h.data());
+                statistics.addIteration(rho);
+
+                if (rho < tol) {
+                    finished = true;
+                    break;
+                }
+
+                if (coefficients[c] <= cancellation * std::sqrt(squaredNorm)) {
+                    dependent = true;
+                    breakdowns++;
+                    break;
+                }
+
+                std::swap(previous, coefficients);
+            }
+        }
+
+        auto y = leastSquares.solve();
+        statistics.lap(phase::other);
+        detail::multiAxpy<TVal>(n, (TVal)1, basis.data(), y.size(), y.data(),
+                                x.data());
+        statistics.lap(phase::vector_update);
+
+        beta = residual(A, x, b, r);
+        statistics.countSpMV();
+        statistics.countReduction();
+        statistics.lap(phase::spmv);
+    }
+
+    JWLogInfo << "s-step GMRES used " << kernels << " matrix powers kernel(s)"
+              << endLog;
+    if (breakdowns > 0) {
+        JWLogInfo << "s-step GMRES restarted " << breakdowns
+                  << " time(s) on a dependent basis" << endLog;
+    }
+
+    statistics.finish();
+
+    return statistics.getResiduals();
+}
+
+/** Solve Ax = b using s-step GMRES(m), with m = inner_iterations rounded up to
+ * a multiple of s.
+ * @return the residual norm estimate after each iteration */
+template <typename TVal, typename TIdx>
+std::vector<TVal> solveSStep(Zee::DSparseMatrix<TVal, TIdx>& A,
+                             const Zee::DVector<TVal, TIdx>& b,
+                             Zee::DVector<TVal, TIdx>& x, TIdx s,
+                             TIdx outer_iterations, TIdx inner_iterations,
+                             TVal tol, bool plotResiduals = false,
+                             bool benchmark = false) {
+    // the benchmark reports the time spent in each phase
+    SolverStatistics<TVal> statistics;
+    if (benchmark) {
+        statistics.setCommunication(A.getProcs(), A.communicationVolume());
+    }
+    auto rhos = solveSStep(A, b, x, s, outer_iterations, inner_iterations,
+                           tol, statistics);
+
+    if (benchmark) statistics.report("s-step GMRES");
+
+    if (plotResiduals) {
+        JWLogVar(rhos);
+        auto p = Zee::Plotter<TVal>();
+        p["xlabel"] = "iterations";
+        p["ylabel"] = "$\\rho$";
+        p["yscale"] = "log";
+        p["title"] = "s-step GMRES: residual norm";
+        p.addLine(rhos, "rhos");
+        p.plot("residual_test_s_step", true);
+    }
+
+    return rhos;
+}
+
+}  // namespace GMRES
+
+}  // namespace Zee
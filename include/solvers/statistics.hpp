@@ -0,0 +1,222 @@
+/*
+File: include/solvers/statistics.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "jw.hpp"
+#include "util/default_types.hpp"
+
+namespace Zee {
+
+/** The phases of an iterative solver that are timed separately */
+enum class solver_phase {
+    /** Sparse matrix-vector products */
+    spmv,
+    /** Applications of the preconditioner */
+    preconditioning,
+    /** Orthogonalization against the Krylov basis, including its inner
+     * products */
+    orthogonalization,
+    /** Scaling, copying and updating vectors */
+    vector_update,
+    /** Global reductions that the solver has to wait for, such as norms */
+    synchronization,
+    /** Everything else, e.g. the small dense problems */
+    other
+};
+
+constexpr std::size_t solver_phase_count = 6;
+
+/** @return a short name of the phase, for reports */
+inline std::string phaseName(solver_phase phase) {
+    switch (phase) {
+        case solver_phase::spmv:
+            return "spmv";
+        case solver_phase::preconditioning:
+            return "preconditioning";
+        case solver_phase::orthogonalization:
+            return "orthogonalization";
+        case solver_phase::vector_update:
+            return "vector update";
+        case solver_phase::synchronization:
+            return "synchronization";
+        default:
+            return "other";
+    }
+}
+
+/** Statistics of a solve, collected by the solver while it runs: the residual
+ * norm estimate of every iteration, the time spent in each phase, and the
+ * number of SpMVs and global reductions.
+ *
+ * The bytes communicated follow the model of a distributed-memory machine
+ * with a processor per image: an SpMV communicates the communication volume
+ * of the partitioning, and a reduction of k values gathers and broadcasts
+ * (p - 1) k values.
+ *
+ * An optional callback is called after every iteration, with the statistics
+ * so far. The time spent in the callback is not attributed to any phase. */
+template <typename TVal = default_scalar_type>
+class SolverStatistics {
+   public:
+    using TClock = std::chrono::steady_clock;
+    using TCallback = std::function<void(const SolverStatistics<TVal>&)>;
+
+    SolverStatistics() { start(); }
+
+    /** Call `callback` after every iteration */
+    void setCallback(TCallback callback) { callback_ = callback; }
+
+    /** Set the number of processors p, and the number of values that an SpMV
+     * communicates, for the model of the bytes communicated */
+    void setCommunication(std::size_t processors, std::size_t spmvVolume) {
+        processors_ = processors;
+        spmvVolume_ = spmvVolume;
+    }
+
+    // ------------------------------------------------------------------------
+    // Recording, by the solvers
+
+    /** Clear the statistics of a previous solve, and start the clock */
+    void start() {
+        residuals_.clear();
+        seconds_.fill(0);
+        restarts_ = 0;
+        spmvs_ = 0;
+        reductions_ = 0;
+        bytes_ = 0;
+        total_ = 0;
+        start_ = TClock::now();
+        lap_ = start_;
+    }
+
+    /** Attribute the time since the previous lap to `phase` */
+    void lap(solver_phase phase) {
+        auto now = TClock::now();
+        seconds_[(std::size_t)phase] +=
+            std::chrono::duration<double>(now - lap_).count();
+        lap_ = now;
+    }
+
+    void countSpMV(std::size_t count = 1) {
+        spmvs_ += count;
+        bytes_ += count * spmvVolume_ * sizeof(TVal);
+    }
+
+    /** Count a global reduction of the given number of values */
+    void countReduction(std::size_t values = 1) {
+        reductions_++;
+        if (processors_ > 1) {
+            bytes_ += 2 * (processors_ - 1) * values * sizeof(TVal);
+        }
+    }
+
+    void countRestart() { restarts_++; }
+
+    /** Record the residual norm (estimate) of an iteration. The time since
+     * the previous lap is attributed to `other`. */
+    void addIteration(TVal residual) {
+        lap(solver_phase::other);
+        residuals_.push_back(residual);
+        if (callback_) {
+            callback_(*this);
+            lap_ = TClock::now();
+        }
+    }
+
+    /** Stop the clock */
+    void finish() {
+        lap(solver_phase::other);
+        total_ = std::chrono::duration<double>(TClock::now() - start_).count();
+    }
+
+    // ------------------------------------------------------------------------
+    // Results
+
+    const std::vector<TVal>& getResiduals() const { return residuals_; }
+
+    std::size_t getIterations() const { return residuals_.size(); }
+
+    std::size_t getRestarts() const { return restarts_; }
+
+    /** @return the time spent in `phase`, in seconds */
+    double getSeconds(solver_phase phase) const {
+        return seconds_[(std::size_t)phase];
+    }
+
+    /** @return the wall-clock time of the solve, in seconds, or the time
+     * since the start if the solve is still running */
+    double getTotalSeconds() const {
+        if (total_ > 0) return total_;
+        return std::chrono::duration<double>(TClock::now() - start_).count();
+    }
+
+    std::size_t getSpMVs() const { return spmvs_; }
+
+    std::size_t getReductions() const { return reductions_; }
+
+    std::size_t getBytesCommunicated() const { return bytes_; }
+
+    /** Log a table with the time spent in each phase */
+    void report(std::string title) const {
+        auto total = getTotalSeconds();
+        auto hline =
+            "----------------------------------------------------------";
+
+        std::stringstream output;
+        output << "\n" << hline << '\n';
+        for (std::size_t p = 0; p < solver_phase_count; ++p) {
+            auto name = phaseName((solver_phase)p);
+            name.resize(30, ' ');
+            auto ms = seconds_[p] * 1000;
+            output << std::fixed << std::setprecision(2) << name << " \t" << ms
+                   << " ms \t" << ((total > 0) ? seconds_[p] / total : 0) * 100
+                   << "%" << '\n';
+        }
+        output << hline << '\n'
+               << getIterations() << " iterations, " << spmvs_ << " SpMVs, "
+               << reductions_ << " reductions, " << bytes_
+               << " bytes communicated";
+
+        JWLogBenchmark << title << " total runtime: " << total * 1000 << " ms"
+                       << output.str() << endLog;
+    }
+
+   private:
+    TCallback callback_;
+
+    std::size_t processors_ = 1;
+    std::size_t spmvVolume_ = 0;
+
+    std::vector<TVal> residuals_;
+    std::array<double, solver_phase_count> seconds_;
+    std::size_t restarts_ = 0;
+    std::size_t spmvs_ = 0;
+    std::size_t reductions_ = 0;
+    std::size_t bytes_ = 0;
+    double total_ = 0;
+
+    TClock::time_point start_;
+    TClock::time_point lap_;
+};
+
+}  // namespace Zee
@@ -0,0 +1,152 @@
+/*
+File: include/solvers/triangular.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "../util/common.hpp"
+
+namespace Zee {
+
+namespace detail {
+
+/** Levels are only processed in parallel if they hold at least this many
+ * rows on average, since every level ends with a barrier. */
+constexpr std::size_t level_parallel_threshold = 64;
+
+/** A dependency-level schedule for a sparse triangular solve. Row i of a
+ * lower triangular matrix depends on the rows j < i with a non-zero (i, j),
+ * and is in level 1 + max(level(j)). The rows in a level are independent, so
+ * a level can be processed in parallel once the previous levels are done.
+ * For an upper triangular matrix the dependencies are on j > i. */
+template <typename TIdx>
+class LevelSchedule {
+   public:
+    /** Build the schedule for the strictly lower (or upper) part of the
+     * matrix in compressed rows, where diagonal[i] is the position of the
+     * diagonal element of row i. */
+    void build(TIdx n, const std::vector<TIdx>& rowStart,
+               const std::vector<TIdx>& cols,
+               const std::vector<TIdx>& diagonal, bool lower) {
+        std::vector<TIdx> level(n, 0);
+        TIdx levels = 0;
+        for (TIdx k = 0; k < n; ++k) {
+            auto i = lower ? k : n - 1 - k;
+            auto first = lower ? rowStart[i] : diagonal[i] + 1;
+            auto last = lower ? diagonal[i] : rowStart[i + 1];
+            TIdx depth = 0;
+            for (auto p = first; p < last; ++p) {
+                depth = std::max(depth, (TIdx)(level[cols[p]] + 1));
+            }
+            level[i] = depth;
+            levels = std::max(levels, (TIdx)(depth + 1));
+        }
+        if (n == 0) levels = 0;
+
+        // bucket the rows by level
+        levelStart_.assign(levels + 1, 0);
+        for (TIdx i = 0; i < n; ++i) {
+            levelStart_[level[i] + 1]++;
+        }
+        for (TIdx l = 0; l < levels; ++l) {
+            levelStart_[l + 1] += levelStart_[l];
+        }
+        rows_.resize(n);
+        auto next = levelStart_;
+        for (TIdx k = 0; k < n; ++k) {
+            auto i = lower ? k : n - 1 - k;
+            rows_[next[level[i]]++] = i;
+        }
+    }
+
+    /** @return the number of levels */
+    std::size_t levels() const {
+        return levelStart_.empty() ? 0 : levelStart_.size() - 1;
+    }
+
+    /** Calls func(i) for every row i, respecting the dependencies. Every
+     * level is split over the given number of threads, which synchronize
+     * after each level. */
+    template <typename TFunc>
+    void run(TFunc func, std::size_t threads) const {
+        auto n = rows_.size();
+        if (threads <= 1 || n < levels() * level_parallel_threshold) {
+            for (auto i : rows_) {
+                func(i);
+            }
+            return;
+        }
+
+        Barrier<std::size_t> barrier(threads);
+        auto work = [&](std::size_t t) {
+            for (std::size_t l = 0; l < levels(); ++l) {
+                auto begin = levelStart_[l];
+                auto size = levelStart_[l + 1] - begin;
+                auto last = begin + ((t + 1) * size) / threads;
+                for (auto k = begin + (t * size) / threads; k < last; ++k) {
+                    func(rows_[k]);
+                }
+                barrier.sync();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t t = 1; t < threads; ++t) {
+            workers.push_back(std::thread(work, t));
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+   private:
+    std::vector<TIdx> levelStart_;
+    std::vector<TIdx> rows_;
+};
+
+/** Greedily colors the graph of a square sparsity pattern, given as lists
+ * of (row, column) pairs, such that no two coupled indices share a color.
+ * @return the color of every index, in [0, number of colors) */
+template <typename TIdx, typename TPairs>
+std::vector<TIdx> greedyColoring(TIdx n, const TPairs& pattern) {
+    // the (symmetrized) adjacency lists
+    std::vector<std::vector<TIdx>> neighbours(n);
+    for (const auto& entry : pattern) {
+        if (entry.row() == entry.col()) continue;
+        neighbours[entry.row()].push_back(entry.col());
+        neighbours[entry.col()].push_back(entry.row());
+    }
+
+    const auto none = (TIdx)-1;
+    std::vector<TIdx> color(n, none);
+    std::vector<TIdx> usedBy(n + 1, none);
+    for (TIdx i = 0; i < n; ++i) {
+        for (auto j : neighbours[i]) {
+            if (color[j] != none) usedBy[color[j]] = i;
+        }
+        TIdx c = 0;
+        while (usedBy[c] == i) c++;
+        color[i] = c;
+    }
+
+    return color;
+}
+
+}  // namespace detail
+
+}  // namespace Zee
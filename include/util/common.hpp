@@ -91,12 +91,16 @@ class Barrier {
 
     inline void sync() {
         std::unique_lock<std::mutex> lock(mtx);
+        auto generation = generation_;
         count_++;
         if (count_ == procs_) {
-            cv.notify_all();
+            generation_++;
             count_ = 0;
+            cv.notify_all();
         } else {
-            cv.wait(lock);
+            // the generation guards against spurious wakeups, and against
+            // waking up in a later use of the barrier
+            cv.wait(lock, [&] { return generation != generation_; });
         }
     }
 
@@ -105,6 +109,7 @@ class Barrier {
     std::condition_variable cv;
     TIdx procs_ = 0;
     TIdx count_ = 0;
+    std::size_t generation_ = 0;
 };
 
 }  // namespace Zee
@@ -35,6 +35,105 @@ DSparseMatrix<default_scalar_type, TIdx> eye(TIdx n, TIdx procs) {
     return A;
 }
 
+/** Copy a sparse matrix, converting its values to TTarget. The copy has the
+ * same images, and if A is localized the copy is localized with the same
+ * local indices, so that vectors with the distribution of A can be used with
+ * either matrix. */
+template <typename TTarget, typename TVal, typename TIdx>
+DSparseMatrix<TTarget, TIdx> convertValues(const DSparseMatrix<TVal, TIdx>& A) {
+    DSparseMatrix<TTarget, TIdx> B(A.getRows(), A.getCols(), A.getProcs());
+
+    auto& images = A.getImages();
+    for (TIdx s = 0; s < images.size(); ++s) {
+        auto& image = images[s];
+        auto localized = image->localizedStorage();
+        for (const auto& triplet : *image) {
+            auto i = localized ? image->getLocalIndicesU()[triplet.row()]
+                               : triplet.row();
+            auto j = localized ? image->getLocalIndicesV()[triplet.col()]
+                               : triplet.col();
+            B.pushTriplet(s, Triplet<TTarget, TIdx>(i, j, triplet.value()));
+        }
+    }
+
+    if (!A.localizedStorage()) return B;
+
+    // the remote indices are derived from the same non-zeros, so only the
+    // owned indices have to be passed on
+    for (TIdx s = 0; s < images.size(); ++s) {
+        auto& image = images[s];
+        auto& target = B.getMutableImages()[s];
+
+        auto& indicesV = image->getLocalIndicesV();
+        auto& indicesU = image->getLocalIndicesU();
+        target->setLocalIndices(
+            std::vector<TIdx>(indicesV.begin(),
+                              indicesV.begin() + image->getNumLocalV()),
+            std::vector<TIdx>(indicesU.begin(),
+                              indicesU.begin() + image->getNumLocalU()));
+        target->getRemoteOwnersV() = image->getRemoteOwnersV();
+        target->getRemoteOwnersU() = image->getRemoteOwnersU();
+        target->localizeStorage();
+
+        JWAssert(target->getLocalIndicesV() == indicesV);
+        JWAssert(target->getLocalIndicesU() == indicesU);
+    }
+
+    return B;
+}
+
+/** Create the matrix of the convection-diffusion operator
+ * \f$-\Delta u + c (u_x + u_y)\f$ on a k x k grid, discretized with the
+ * five-point stencil and central differences. The matrix is of size
+ * k^2 x k^2, and the coefficient c (times the mesh width) controls how
+ * nonsymmetric it is. */
+template <typename TIdx>
+DSparseMatrix<default_scalar_type, TIdx> convectionDiffusion(
+    TIdx k, default_scalar_type c, TIdx procs,
+    partitioning_scheme scheme = partitioning_scheme::cyclic) {
+    using TVal = default_scalar_type;
+
+    auto n = k * k;
+    std::vector<Triplet<TVal, TIdx>> coefficients;
+    coefficients.reserve(5 * n);
+
+    auto convection = c / 2;
+    for (TIdx i = 0; i < k; ++i) {
+        for (TIdx j = 0; j < k; ++j) {
+            auto row = i * k + j;
+            coefficients.push_back(Triplet<TVal, TIdx>(row, row, 4));
+            if (i > 0)
+                coefficients.push_back(
+                    Triplet<TVal, TIdx>(row, row - k, -1 - convection));
+            if (i + 1 < k)
+                coefficients.push_back(
+                    Triplet<TVal, TIdx>(row, row + k, -1 + convection));
+            if (j > 0)
+                coefficients.push_back(
+                    Triplet<TVal, TIdx>(row, row - 1, -1 - convection));
+            if (j + 1 < k)
+                coefficients.push_back(
+                    Triplet<TVal, TIdx>(row, row + 1, -1 + convection));
+        }
+    }
+
+    DSparseMatrix<TVal, TIdx> A(n, n);
+    A.setDistributionScheme(scheme, procs);
+
+    A.setFromTriplets(coefficients.begin(), coefficients.end());
+
+    return A;
+}
+
+/** Create the (symmetric positive definite) matrix of the five-point
+ * Laplacian on a k x k grid, which is of size k^2 x k^2 */
+template <typename TIdx>
+DSparseMatrix<default_scalar_type, TIdx> poisson(
+    TIdx k, TIdx procs,
+    partitioning_scheme scheme = partitioning_scheme::cyclic) {
+    return convectionDiffusion<TIdx>(k, 0, procs, scheme);
+}
+
 /** Create a random sparse (n x m) matrix */
 template <typename TIdx>
 DSparseMatrix<double, TIdx> rand(TIdx m, TIdx n, TIdx procs, double density) {
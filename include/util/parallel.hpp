@@ -0,0 +1,73 @@
+/*
+File: include/util/parallel.hpp
+
+This file is part of the Zee partitioning framework
+
+Copyright (C) 2015 Jan-Willem Buurlage <janwillembuurlage@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License (LGPL)
+as published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Zee {
+
+/** The number of worker threads used by the dense (vector) kernels. By default
+ * this is the hardware concurrency of the system. */
+inline std::size_t& kernelThreads() {
+    static std::size_t threads =
+        std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
+
+/** Set the number of worker threads used by the dense (vector) kernels */
+inline void setKernelThreads(std::size_t threads) {
+    kernelThreads() = std::max(threads, (std::size_t)1);
+}
+
+/** Chunked work is only spread over multiple threads if there are at least
+ * this many chunks, since spawning threads is not free. */
+constexpr std::size_t parallel_chunk_threshold = 16;
+
+/** Calls `func(first, last)` for disjoint contiguous ranges of chunks that
+ * together cover [0, chunks). Every range is processed by its own thread,
+ * similar to `DSparseMatrixBase::compute`.
+ *
+ * The ranges that are handed out depend on the number of threads, so callers
+ * that need deterministic results should only write per-chunk results and
+ * combine these afterwards. */
+template <typename TFunc>
+void parallelChunks(std::size_t chunks, TFunc func,
+                    std::size_t threads = kernelThreads()) {
+    if (chunks < parallel_chunk_threshold) threads = 1;
+    threads = std::max(std::min(threads, chunks), (std::size_t)1);
+
+    if (threads == 1) {
+        func((std::size_t)0, chunks);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t t = 1; t < threads; ++t) {
+        workers.push_back(std::thread(func, (t * chunks) / threads,
+                                      ((t + 1) * chunks) / threads));
+    }
+
+    // the calling thread takes the first range
+    func((std::size_t)0, chunks / threads);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}  // namespace Zee
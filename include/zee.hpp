@@ -16,7 +16,13 @@ License, or (at your option) any later version.
 #include "util/default_types.hpp"
 
 #include "matrix/base/base.hpp"
+#include "matrix/dense/block_kernels.hpp"
 #include "matrix/dense/dense.hpp"
+#include "matrix/dense/partitioned_vector.hpp"
+#include "matrix/dense/tsqr.hpp"
+#include "matrix/dense/vector_kernels.hpp"
+#include "matrix/sparse/matrix_powers.hpp"
+#include "matrix/sparse/overlap.hpp"
 #include "matrix/sparse/sparse.hpp"
 
 #include "operations/operation_types.hpp"
@@ -34,9 +40,28 @@ License, or (at your option) any later version.
 #include "util/common.hpp"
 #include "util/matrix_market.hpp"
 #include "util/matrix_toolbox.hpp"
+#include "util/parallel.hpp"
 #include "util/plotter.hpp"
 #include "util/report.hpp"
 
 #include "jw.hpp"
 
+#include "solvers/amg.hpp"
+#include "solvers/bicgstab.hpp"
+#include "solvers/block_gmres.hpp"
+#include "solvers/cg.hpp"
+#include "solvers/cgls.hpp"
+#include "solvers/chebyshev.hpp"
+#include "solvers/eigensolvers.hpp"
+#include "solvers/gcro_dr.hpp"
 #include "solvers/gmres.hpp"
+#include "solvers/gmres_dr.hpp"
+#include "solvers/idrs.hpp"
+#include "solvers/ilu.hpp"
+#include "solvers/mixed_precision.hpp"
+#include "solvers/pagerank.hpp"
+#include "solvers/pipelined_gmres.hpp"
+#include "solvers/preconditioners.hpp"
+#include "solvers/s_step_gmres.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/triangular.hpp"
@@ -29,3 +29,1393 @@ TEST_CASE("we can solve a non-symmetric system", "[solvers]") {
 
     REQUIRE(r.norm() / ones.norm() < 100 * tol);
 }
+
+TEST_CASE("we can orthogonalize using CGS2", "[solvers]") {
+    Zee::DSparseMatrix<> matrix{"test/mtx/ex24.mtx", 1};
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    auto x = Zee::DVector<>{n, 0.0};
+
+    auto tol = 1e-2;
+
+    Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+        matrix, b, x, 1, n, tol, false, false,
+        Zee::GMRES::orthogonalization::cgs2);
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = x - ones;
+
+    REQUIRE(r.norm() / ones.norm() < 100 * tol);
+}
+
+TEST_CASE("GMRES updates x with the full least-squares solution",
+          "[solvers]") {
+    // for the identity the residual estimate drops to zero in the first
+    // iteration, so the solve stops early and x has to include the last
+    // basis vector
+    Zee::default_index_type n = 100;
+    auto matrix = Zee::eye<Zee::default_index_type>(n, 1);
+
+    auto b = Zee::DVector<>{n, 1.0};
+    auto ones = Zee::DVector<>{n, 1.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    Zee::default_scalar_type tol = 1e-3;
+    auto x = Zee::DVector<>{n, 0.0};
+    Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+        matrix, b, x, 1, 10, tol);
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * x;
+    REQUIRE(r.norm() < tol);
+}
+
+TEST_CASE("repeated solves reuse the workspace", "[solvers]") {
+    Zee::DSparseMatrix<> matrix{"test/mtx/ex24.mtx", 1};
+
+    auto n = matrix.getCols();
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    auto& pool = Zee::VectorPool<Zee::default_scalar_type>::global();
+    auto x = Zee::DVector<>{n, 0.0};
+    Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+        matrix, b, x, 1, 20, 1e-2);
+
+    auto misses = pool.misses();
+    x.reset();
+    Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+        matrix, b, x, 1, 20, 1e-2);
+    REQUIRE(pool.misses() == misses);
+}
+
+TEST_CASE("GMRES starts from the initial guess", "[solvers]") {
+    Zee::DSparseMatrix<> matrix{"test/mtx/ex24.mtx", 1};
+
+    auto n = matrix.getCols();
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+
+    SECTION("a solution is left alone") {
+        auto x = Zee::DVector<>{n, 1.0};
+        auto rhos = Zee::GMRES::solve(matrix, b, x, 1u, 20u, tol);
+        REQUIRE(rhos.empty());
+        REQUIRE(x == ones);
+    }
+
+    SECTION("a good guess saves iterations") {
+        auto x = Zee::DVector<>{n, 0.0};
+        auto rhos = Zee::GMRES::solve(matrix, b, x, 10u, 30u, tol);
+
+        auto y = Zee::DVector<>{n, 0.0};
+        Zee::scale(0.99f, ones, y);
+        auto guessedRhos = Zee::GMRES::solve(matrix, b, y, 10u, 30u, tol);
+
+        REQUIRE(guessedRhos.back() < tol);
+        REQUIRE(guessedRhos.size() < rhos.size());
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = b - matrix * y;
+        REQUIRE(r.norm() < 2 * tol);
+    }
+}
+
+TEST_CASE("pipelined GMRES converges like GMRES", "[solvers]") {
+    Zee::DSparseMatrix<> matrix{"test/mtx/ex24.mtx", 1};
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    auto tol = 1e-2;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos =
+        Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+            matrix, b, x, 10, 30, tol);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto pipelinedRhos = Zee::GMRES::solvePipelined<Zee::default_scalar_type,
+                                                    Zee::default_index_type>(
+        matrix, b, y, 10, 30, tol);
+
+    REQUIRE(pipelinedRhos.size() == rhos.size());
+
+    // the early iterations agree up to rounding
+    for (std::size_t i = 0; i < 5; ++i) {
+        REQUIRE(std::abs(pipelinedRhos[i] - rhos[i]) <= 1e-3 * rhos[i]);
+    }
+
+    // and the convergence is comparable
+    REQUIRE(pipelinedRhos.back() < 2 * rhos.back());
+    REQUIRE(rhos.back() < 2 * pipelinedRhos.back());
+
+    // the estimate matches the actual residual
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(std::abs(r.norm() - pipelinedRhos.back()) <
+            0.1 * pipelinedRhos.back());
+}
+
+TEST_CASE("we can solve a symmetric positive definite system", "[solvers]") {
+    auto matrix = Zee::poisson<Zee::default_index_type>(30, 4);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+
+    SECTION("without preconditioner") {
+        auto x = Zee::DVector<>{n, 0.0};
+        auto rhos =
+            Zee::CG::solve<Zee::default_scalar_type, Zee::default_index_type>(
+                matrix, b, x, n, tol);
+
+        REQUIRE(rhos.back() < tol);
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = x - ones;
+        REQUIRE(r.norm() / ones.norm() < 1e-2);
+    }
+
+    SECTION("with a Jacobi preconditioner") {
+        Zee::JacobiPreconditioner<Zee::default_scalar_type,
+                                  Zee::default_index_type>
+            jacobi(matrix);
+
+        auto x = Zee::DVector<>{n, 0.0};
+        auto rhos = Zee::CG::solve(matrix, b, x, jacobi, n, tol);
+
+        REQUIRE(rhos.back() < tol);
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = x - ones;
+        REQUIRE(r.norm() / ones.norm() < 1e-2);
+    }
+}
+
+TEST_CASE("we can solve with short recurrences", "[solvers]") {
+    auto matrix = Zee::poisson<Zee::default_index_type>(30, 4);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+    Zee::default_index_type maxIterations = 1000;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    std::vector<Zee::default_scalar_type> rhos;
+
+    SECTION("using BiCGStab") {
+        rhos =
+            Zee::BiCGStab::solve<Zee::default_scalar_type,
+                                 Zee::default_index_type>(matrix, b, x,
+                                                          maxIterations, tol);
+    }
+
+    SECTION("using IDR(1)") {
+        rhos = Zee::IDR::solve<Zee::default_scalar_type,
+                               Zee::default_index_type>(matrix, b, x, 1,
+                                                        maxIterations, tol);
+    }
+
+    SECTION("using IDR(4) with a Jacobi preconditioner") {
+        Zee::JacobiPreconditioner<Zee::default_scalar_type,
+                                  Zee::default_index_type>
+            jacobi(matrix);
+        rhos = Zee::IDR::solve(matrix, b, x, (Zee::default_index_type)4,
+                               jacobi, maxIterations, tol);
+    }
+
+    REQUIRE(rhos.back() < tol);
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * x;
+    REQUIRE(r.norm() < 10 * tol);
+
+    r = x - ones;
+    REQUIRE(r.norm() / ones.norm() < 1e-2);
+}
+
+TEST_CASE("we can solve least-squares problems", "[solvers]") {
+    // A = [P; I], with P the Laplacian on a 10 x 10 grid
+    auto laplacian = Zee::poisson<Zee::default_index_type>(10, 1);
+    Zee::default_index_type n = laplacian.getCols();
+
+    std::vector<Zee::Triplet<>> coefficients;
+    for (auto& image : laplacian.getImages()) {
+        for (auto& triplet : *image) {
+            coefficients.push_back(triplet);
+        }
+    }
+    for (Zee::default_index_type i = 0; i < n; ++i) {
+        coefficients.push_back(Zee::Triplet<>(n + i, i, 1));
+    }
+
+    Zee::DSparseMatrix<> matrix(2 * n, n);
+    matrix.setDistributionScheme(Zee::partitioning_scheme::cyclic, 3);
+    matrix.setFromTriplets(coefficients.begin(), coefficients.end());
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto b = Zee::DVector<>{2 * n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, x, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    SECTION("the transposed product agrees with the normal product") {
+        auto u = Zee::DVector<>{2 * n, 0.0};
+        for (Zee::default_index_type i = 0; i < 2 * n; ++i) {
+            u[i] = (Zee::default_scalar_type)(i % 5);
+        }
+        auto v = Zee::DVector<>{n, 1.0};
+        auto w = Zee::DVector<>{n, 0.0};
+        Zee::multiplyTransposed(matrix, u, w);
+
+        // <A^T u, v> = <u, A v>
+        auto Av = Zee::DVector<>{2 * n, 0.0};
+        Av = matrix * v;
+        REQUIRE(std::abs(w.dot(v) - u.dot(Av)) <= 1e-4 * std::abs(u.dot(Av)));
+    }
+
+    SECTION("a consistent system") {
+        auto ones = Zee::DVector<>{n, 1.0};
+        b = matrix * ones;
+
+        auto rhos = Zee::CGLS::solve<Zee::default_scalar_type,
+                                     Zee::default_index_type>(matrix, b, x, n,
+                                                              1e-4);
+        REQUIRE(rhos.back() < 1e-4);
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = x - ones;
+        REQUIRE(r.norm() / ones.norm() < 1e-3);
+    }
+
+    SECTION("an inconsistent system") {
+        for (Zee::default_index_type i = 0; i < 2 * n; ++i) {
+            b[i] = (Zee::default_scalar_type)(i % 3);
+        }
+
+        auto rhos = Zee::CGLS::solve<Zee::default_scalar_type,
+                                     Zee::default_index_type>(matrix, b, x, n,
+                                                              1e-4);
+        REQUIRE(rhos.back() < 1e-4);
+
+        // the residual is orthogonal to the range of A
+        auto r = Zee::DVector<>{2 * n, 0.0};
+        r = b - matrix * x;
+        auto s = Zee::DVector<>{n, 0.0};
+        Zee::multiplyTransposed(matrix, r, s);
+        REQUIRE(s.norm() < 1e-3 * b.norm());
+    }
+}
+
+TEST_CASE("incomplete factorizations", "[solvers]") {
+    // ILU(0) of a tridiagonal matrix is its exact LU factorization
+    Zee::default_index_type n = 10;
+    std::vector<Zee::Triplet<>> entries;
+    for (Zee::default_index_type i = 0; i < n; ++i) {
+        entries.push_back(Zee::Triplet<>(i, i, 4));
+        if (i > 0) entries.push_back(Zee::Triplet<>(i, i - 1, -1));
+        if (i + 1 < n) entries.push_back(Zee::Triplet<>(i, i + 1, -2));
+    }
+
+    Zee::detail::SparseILU0<Zee::default_scalar_type,
+                            Zee::default_index_type>
+        ilu;
+    ilu.factor(n, entries);
+    REQUIRE(ilu.nonZeros() == entries.size());
+    REQUIRE(ilu.zeroPivots() == 0);
+
+    // solve for a known solution
+    std::vector<Zee::default_scalar_type> x(n, 1);
+    std::vector<Zee::default_scalar_type> b(n, 0);
+    for (auto& entry : entries) {
+        b[entry.row()] += entry.value() * x[entry.col()];
+    }
+    ilu.solve(b.data());
+    for (Zee::default_index_type i = 0; i < n; ++i) {
+        REQUIRE(std::abs(b[i] - 1) < 1e-5);
+    }
+}
+
+TEST_CASE("block-Jacobi preconditioning reduces iterations", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        40, 0.5, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos =
+        Zee::GMRES::solve<Zee::default_scalar_type, Zee::default_index_type>(
+            matrix, b, x, 20, 30, tol);
+
+    Zee::BlockJacobiPreconditioner<Zee::default_scalar_type,
+                                   Zee::default_index_type>
+        blockJacobi(matrix);
+    REQUIRE(blockJacobi.getBlocks() == 4);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto preconditionedRhos =
+        Zee::GMRES::solve(matrix, b, y, blockJacobi,
+                          (Zee::default_index_type)20,
+                          (Zee::default_index_type)30, tol);
+
+    REQUIRE(preconditionedRhos.back() < tol);
+    REQUIRE(2 * preconditionedRhos.size() < rhos.size());
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(r.norm() < 10 * tol);
+}
+
+TEST_CASE("overlapping Schwarz preconditioning", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        40, 0.5, 8, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+    Zee::default_index_type outer = 20;
+    Zee::default_index_type inner = 30;
+
+    Zee::BlockJacobiPreconditioner<Zee::default_scalar_type,
+                                   Zee::default_index_type>
+        blockJacobi(matrix);
+    auto x = Zee::DVector<>{n, 0.0};
+    auto blockJacobiRhos =
+        Zee::GMRES::solve(matrix, b, x, blockJacobi, outer, inner, tol);
+
+    Zee::AdditiveSchwarzPreconditioner<Zee::default_scalar_type,
+                                       Zee::default_index_type>
+        schwarz(matrix, 2);
+    REQUIRE(schwarz.getBlocks() == 8);
+    for (std::size_t s = 0; s < schwarz.getBlocks(); ++s) {
+        // every subdomain gains at least one layer of the grid
+        REQUIRE(schwarz.getSubdomainSize(s) >= n / 8 + 40);
+    }
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto schwarzRhos =
+        Zee::GMRES::solve(matrix, b, y, schwarz, outer, inner, tol);
+
+    REQUIRE(schwarzRhos.back() < tol);
+    REQUIRE(schwarzRhos.size() < blockJacobiRhos.size());
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(r.norm() < 2 * tol);
+
+    SECTION("without overlap it is block Jacobi") {
+        Zee::AdditiveSchwarzPreconditioner<Zee::default_scalar_type,
+                                           Zee::default_index_type>
+            restricted(matrix, 0);
+        auto u = Zee::DVector<>{n, 0.0};
+        auto v = Zee::DVector<>{n, 0.0};
+        restricted.apply(b, u);
+        blockJacobi.apply(b, v);
+        REQUIRE(u == v);
+    }
+}
+
+TEST_CASE("level-scheduled triangular solves", "[solvers]") {
+    // the five-point Laplacian on a k x k grid
+    Zee::default_index_type k = 40;
+    auto n = k * k;
+    std::vector<Zee::Triplet<>> entries;
+    for (Zee::default_index_type i = 0; i < k; ++i) {
+        for (Zee::default_index_type j = 0; j < k; ++j) {
+            auto row = i * k + j;
+            entries.push_back(Zee::Triplet<>(row, row, 4));
+            if (i > 0) entries.push_back(Zee::Triplet<>(row, row - k, -1));
+            if (i + 1 < k) entries.push_back(Zee::Triplet<>(row, row + k, -1));
+            if (j > 0) entries.push_back(Zee::Triplet<>(row, row - 1, -1));
+            if (j + 1 < k) entries.push_back(Zee::Triplet<>(row, row + 1, -1));
+        }
+    }
+
+    std::vector<Zee::default_scalar_type> b(n);
+    for (Zee::default_index_type i = 0; i < n; ++i) {
+        b[i] = (Zee::default_scalar_type)(i % 11) - 5;
+    }
+
+    Zee::detail::SparseILU0<Zee::default_scalar_type,
+                            Zee::default_index_type>
+        ilu;
+
+    SECTION("the levels of the natural ordering are the anti-diagonals") {
+        ilu.factor(n, entries);
+        REQUIRE(ilu.lowerLevels() == 2 * k - 1);
+        REQUIRE(ilu.upperLevels() == 2 * k - 1);
+    }
+
+    SECTION("a multicolor ordering has one level per color") {
+        ilu.factor(n, entries, Zee::ilu_ordering::multicolor);
+        REQUIRE(ilu.lowerLevels() == 2);
+        REQUIRE(ilu.upperLevels() == 2);
+
+        // the parallel solve does the same operations for every row
+        auto serial = b;
+        ilu.solve(serial.data(), 1);
+        auto parallel = b;
+        ilu.solve(parallel.data(), 4);
+        REQUIRE(serial == parallel);
+    }
+}
+
+TEST_CASE("multicolor block-Jacobi preconditioning", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        40, 0.5, 2, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+    Zee::default_index_type outer = 20;
+    Zee::default_index_type inner = 30;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos = Zee::GMRES::solve(matrix, b, x, outer, inner, tol);
+
+    Zee::BlockJacobiPreconditioner<Zee::default_scalar_type,
+                                   Zee::default_index_type>
+        blockJacobi(matrix, Zee::ilu_ordering::multicolor);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto preconditionedRhos =
+        Zee::GMRES::solve(matrix, b, y, blockJacobi, outer, inner, tol);
+
+    REQUIRE(preconditionedRhos.back() < tol);
+    REQUIRE(preconditionedRhos.size() < rhos.size());
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(r.norm() < 2 * tol);
+}
+
+TEST_CASE("mixed-precision iterative refinement", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using THighVector = Zee::DVector<double, TIdx>;
+
+    auto matrix = Zee::convectionDiffusion<TIdx>(
+        30, 0.5, 2, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    auto highMatrix = Zee::convertValues<double>(matrix);
+    auto lowMatrix = Zee::convertValues<float>(highMatrix);
+
+    REQUIRE(highMatrix.nonZeros() == matrix.nonZeros());
+    REQUIRE(highMatrix.localizedStorage());
+
+    auto highOnes = THighVector{n, 1.0};
+    auto highB = THighVector{n, 0.0};
+    highB = highMatrix * highOnes;
+
+    // the copies act as the original matrix
+    b = lowMatrix * ones;
+    for (TIdx i = 0; i < n; ++i) {
+        REQUIRE(std::abs(b[i] - highB[i]) <= 1e-5 * std::abs(highB[i]));
+    }
+
+    double tol = 1e-10 * highB.norm();
+
+    SECTION("refinement reaches beyond the low precision") {
+        auto x = THighVector{n, 0.0};
+        auto residuals = Zee::IterativeRefinement::solve(
+            highMatrix, lowMatrix, highB, x, (TIdx)10, (TIdx)10, (TIdx)30,
+            tol);
+
+        REQUIRE(residuals.back() < tol);
+        for (std::size_t k = 1; k < residuals.size(); ++k) {
+            REQUIRE(residuals[k] <
+                    Zee::IterativeRefinement::stall_factor * residuals[k - 1]);
+        }
+
+        auto r = THighVector{n, 0.0};
+        r = highB - highMatrix * x;
+        REQUIRE(r.norm() < tol);
+    }
+
+    SECTION("a stalled refinement falls back to high precision") {
+        // a single low-precision Krylov iteration hardly reduces the residual
+        auto x = THighVector{n, 0.0};
+        auto residuals = Zee::IterativeRefinement::solve(
+            highMatrix, lowMatrix, highB, x, (TIdx)10, (TIdx)1, (TIdx)1,
+            1e-6 * highB.norm(), 1e-4f);
+
+        // the driver stops after the high-precision correction that follows
+        // the first stalled step
+        std::size_t stalled = 1;
+        while (stalled < residuals.size() &&
+               residuals[stalled] <= Zee::IterativeRefinement::stall_factor *
+                                         residuals[stalled - 1]) {
+            stalled++;
+        }
+        REQUIRE(stalled + 2 == residuals.size());
+        REQUIRE(residuals.back() < residuals[stalled]);
+    }
+}
+
+TEST_CASE("s-step GMRES converges like GMRES", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        30, 0.5, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+    Zee::default_index_type outer = 20;
+    Zee::default_index_type inner = 30;
+    Zee::default_index_type s = 3;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos = Zee::GMRES::solve(matrix, b, x, outer, inner, tol);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto sStepRhos =
+        Zee::GMRES::solveSStep(matrix, b, y, s, outer, inner, tol);
+
+    REQUIRE(sStepRhos.back() < tol);
+
+    // the first cycle spans the same Krylov subspace
+    for (std::size_t i = 0; i < 10; ++i) {
+        REQUIRE(std::abs(sStepRhos[i] - rhos[i]) <= 1e-2 * rhos[i]);
+    }
+    REQUIRE(sStepRhos.size() <= rhos.size() + inner);
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(r.norm() < 2 * tol);
+}
+
+TEST_CASE("block GMRES solves for multiple right-hand sides", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        30, 0.5, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+    Zee::default_index_type q = 6;
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    // the last right-hand side is already solved by the initial guess
+    std::vector<Zee::DVector<>> B(q, Zee::DVector<>{n, 0.0});
+    std::vector<Zee::DVector<>> X(q, Zee::DVector<>{n, 0.0});
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<Zee::default_scalar_type> distribution(-1,
+                                                                          1);
+    for (Zee::default_index_type c = 0; c + 1 < q; ++c) {
+        for (Zee::default_index_type i = 0; i < n; ++i) {
+            B[c][i] = distribution(generator);
+        }
+    }
+
+    Zee::default_scalar_type tol = 1e-4 * B[0].norm();
+    Zee::default_index_type outer = 20;
+    Zee::default_index_type inner = 30;
+
+    auto rhos = Zee::GMRES::solveBlock(matrix, B, X, outer, inner, tol);
+
+    REQUIRE(rhos[q - 1].empty());
+    for (Zee::default_index_type c = 0; c < q; ++c) {
+        auto r = Zee::DVector<>{n, 0.0};
+        r = B[c] - matrix * X[c];
+        REQUIRE(r.norm() < tol);
+    }
+
+    // the block Krylov space contains the spaces of the single right-hand
+    // sides, so the block steps (SpMMs) do not exceed the worst SpMV count
+    std::size_t blockSteps = 0;
+    std::size_t singleSteps = 0;
+    for (Zee::default_index_type c = 0; c + 1 < q; ++c) {
+        auto x = Zee::DVector<>{n, 0.0};
+        auto singleRhos =
+            Zee::GMRES::solve(matrix, B[c], x, outer, inner, tol);
+        singleSteps = std::max(singleSteps, singleRhos.size());
+        blockSteps = std::max(blockSteps, rhos[c].size());
+    }
+    REQUIRE(blockSteps <= singleSteps);
+}
+
+TEST_CASE("deflated restarting improves restarted GMRES", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        30, 0.0, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-5 * b.norm();
+    Zee::default_index_type outer = 100;
+    Zee::default_index_type inner = 10;
+    Zee::default_index_type k = 4;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos = Zee::GMRES::solve(matrix, b, x, outer, inner, tol);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto deflatedRhos =
+        Zee::GMRES::solveDeflated(matrix, b, y, outer, inner, k, tol);
+
+    // the first cycle is that of GMRES(m)
+    for (Zee::default_index_type i = 0; i < inner; ++i) {
+        REQUIRE(std::abs(deflatedRhos[i] - rhos[i]) <= 1e-3 * rhos[i]);
+    }
+
+    // the small eigenvalues of the Laplacian are deflated
+    REQUIRE(deflatedRhos.back() < tol);
+    REQUIRE(2 * deflatedRhos.size() < rhos.size());
+
+    auto r = Zee::DVector<>{n, 0.0};
+    r = b - matrix * y;
+    REQUIRE(r.norm() < tol);
+}
+
+TEST_CASE("GCRO-DR recycles a subspace between solves", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using TVal = Zee::default_scalar_type;
+
+    auto matrix = Zee::convectionDiffusion<TIdx>(
+        30, 0.0, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    TIdx outer = 200;
+    TIdx inner = 10;
+    TIdx k = 5;
+    Zee::GMRES::RecycledSubspace<> space(k);
+
+    // a sequence of slowly changing systems with unrelated right-hand sides
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<TVal> distribution(-1, 1);
+    std::size_t steps = 0;
+    std::size_t recycledSteps = 0;
+    for (int t = 0; t < 4; ++t) {
+        matrix.updateValues([](TIdx i, TIdx j, TVal value) {
+            return (i == j) ? value + 1e-4f : value;
+        });
+        for (TIdx i = 0; i < n; ++i) {
+            b[i] = distribution(generator);
+        }
+        TVal tol = 1e-5 * b.norm();
+
+        auto x = Zee::DVector<>{n, 0.0};
+        steps += Zee::GMRES::solve(matrix, b, x, outer, inner, tol).size();
+
+        auto y = Zee::DVector<>{n, 0.0};
+        recycledSteps +=
+            Zee::GMRES::solveRecycled(matrix, b, y, space, outer, inner, tol)
+                .size();
+        REQUIRE(space.size() >= (std::size_t)k);
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = b - matrix * y;
+        REQUIRE(r.norm() < tol);
+    }
+
+    REQUIRE(2 * recycledSteps < steps);
+}
+
+TEST_CASE("GMRES records solver statistics", "[solvers]") {
+    auto matrix = Zee::convectionDiffusion<Zee::default_index_type>(
+        20, 0.5, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    Zee::default_scalar_type tol = 1e-4 * b.norm();
+    Zee::default_index_type outer = 20;
+    Zee::default_index_type inner = 10;
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto rhos = Zee::GMRES::solve(matrix, b, x, outer, inner, tol, false,
+                                  false, Zee::GMRES::orthogonalization::cgs2);
+
+    Zee::SolverStatistics<> statistics;
+    auto volume = matrix.communicationVolume();
+    statistics.setCommunication(matrix.getProcs(), volume);
+
+    std::vector<Zee::default_scalar_type> reported;
+    statistics.setCallback([&](const Zee::SolverStatistics<>& progress) {
+        reported.push_back(progress.getResiduals().back());
+    });
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto recorded =
+        Zee::GMRES::solve(matrix, b, y, outer, inner, tol, statistics,
+                          Zee::GMRES::orthogonalization::cgs2);
+
+    REQUIRE(recorded == rhos);
+    REQUIRE(statistics.getResiduals() == rhos);
+    REQUIRE(reported == rhos);
+
+    // an SpMV per iteration, and one for the residual of every cycle
+    auto iterations = statistics.getIterations();
+    auto cycles = statistics.getRestarts() + 1;
+    REQUIRE(cycles == (iterations + inner - 1) / inner);
+    REQUIRE(statistics.getSpMVs() == iterations + cycles + 1);
+
+    // two block reductions and a norm per iteration, and the norm that is
+    // fused with every residual
+    REQUIRE(statistics.getReductions() == 3 * iterations + cycles + 1);
+    REQUIRE(statistics.getBytesCommunicated() >
+            statistics.getSpMVs() * volume * sizeof(Zee::default_scalar_type));
+
+    double phases = 0;
+    for (std::size_t p = 0; p < Zee::solver_phase_count; ++p) {
+        auto seconds = statistics.getSeconds((Zee::solver_phase)p);
+        REQUIRE(seconds >= 0);
+        phases += seconds;
+    }
+    REQUIRE(statistics.getSeconds(Zee::solver_phase::spmv) > 0);
+    REQUIRE(phases <= statistics.getTotalSeconds() * 1.001);
+}
+
+TEST_CASE("the other solvers record solver statistics", "[solvers]") {
+    using TVal = Zee::default_scalar_type;
+    using TIdx = Zee::default_index_type;
+
+    auto matrix = Zee::poisson<TIdx>(20, 4);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+
+    TVal tol = 1e-4 * b.norm();
+    TIdx maxIterations = 1000;
+
+    Zee::SolverStatistics<> statistics;
+    std::size_t calls = 0;
+    statistics.setCallback([&](const Zee::SolverStatistics<>&) { calls++; });
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto y = Zee::DVector<>{n, 0.0};
+
+    SECTION("CG") {
+        auto rhos = Zee::CG::solve<TVal, TIdx>(matrix, b, x, maxIterations,
+                                               tol);
+        auto recorded = Zee::CG::solve(matrix, b, y, maxIterations, tol,
+                                       statistics);
+        REQUIRE(recorded == rhos);
+
+        // the history of the statistics starts after the initial residual
+        auto iterations = statistics.getIterations();
+        REQUIRE(iterations + 1 == rhos.size());
+        REQUIRE(calls == iterations);
+        REQUIRE(statistics.getResiduals().back() == rhos.back());
+
+        // an SpMV and two reductions per iteration, and the initial residual
+        // with the reduction of its inner products
+        REQUIRE(statistics.getSpMVs() == iterations + 1);
+        REQUIRE(statistics.getReductions() == 2 * iterations + 1);
+    }
+
+    SECTION("BiCGStab") {
+        auto rhos = Zee::BiCGStab::solve<TVal, TIdx>(matrix, b, x,
+                                                     maxIterations, tol);
+        auto recorded = Zee::BiCGStab::solve(matrix, b, y, maxIterations, tol,
+                                             statistics);
+        REQUIRE(recorded == rhos);
+
+        auto iterations = statistics.getIterations();
+        REQUIRE(iterations + 1 == rhos.size());
+        REQUIRE(calls == iterations);
+
+        // two SpMVs and three reductions per iteration
+        REQUIRE(statistics.getSpMVs() == 2 * iterations + 1);
+        REQUIRE(statistics.getReductions() == 3 * iterations + 1);
+    }
+
+    SECTION("pipelined GMRES") {
+        auto rhos = Zee::GMRES::solvePipelined<TVal, TIdx>(matrix, b, x, 20,
+                                                           10, tol);
+        auto recorded = Zee::GMRES::solvePipelined(matrix, b, y, (TIdx)20,
+                                                   (TIdx)10, tol, statistics);
+        REQUIRE(recorded == rhos);
+        REQUIRE(statistics.getResiduals() == rhos);
+        REQUIRE(calls == rhos.size());
+        REQUIRE(statistics.getSpMVs() > statistics.getIterations());
+    }
+
+    SECTION("s-step GMRES") {
+        auto rhos = Zee::GMRES::solveSStep<TVal, TIdx>(matrix, b, x, 2, 20,
+                                                       10, tol);
+        auto recorded = Zee::GMRES::solveSStep(
+            matrix, b, y, (TIdx)2, (TIdx)20, (TIdx)10, tol, statistics);
+        REQUIRE(recorded == rhos);
+        REQUIRE(statistics.getResiduals() == rhos);
+        REQUIRE(calls == rhos.size());
+        REQUIRE(statistics.getSpMVs() > statistics.getIterations());
+    }
+
+    SECTION("GMRES-DR") {
+        auto rhos = Zee::GMRES::solveDeflated<TVal, TIdx>(matrix, b, x, 20,
+                                                          10, 3, tol);
+        auto recorded =
+            Zee::GMRES::solveDeflated(matrix, b, y, (TIdx)20, (TIdx)10,
+                                      (TIdx)3, tol, statistics);
+        REQUIRE(recorded == rhos);
+        REQUIRE(statistics.getResiduals() == rhos);
+        REQUIRE(calls == rhos.size());
+        REQUIRE(statistics.getSpMVs() > statistics.getIterations());
+    }
+
+    SECTION("IDR(s)") {
+        TIdx s = 4;
+        auto rhos = Zee::IDR::solve<TVal, TIdx>(matrix, b, x, s, maxIterations,
+                                                tol);
+        auto recorded = Zee::IDR::solve(matrix, b, y, s, maxIterations, tol,
+                                        statistics);
+        REQUIRE(recorded == rhos);
+
+        // an iteration for every SpMV, after the initial residual
+        auto iterations = statistics.getIterations();
+        REQUIRE(iterations + 1 == rhos.size());
+        REQUIRE(calls == iterations);
+        REQUIRE(statistics.getSpMVs() == iterations + 1);
+
+        // the shadow space and the initial residual norm, then a cycle of s
+        // steps that orthogonalize against k vectors and a reduction step
+        std::size_t reductions = s * (s + 1) / 2 + 1;
+        for (std::size_t i = 0; i < iterations; ++i) {
+            std::size_t k = i % (s + 1);
+            if (k == 0) reductions += 1;
+            reductions += (k < (std::size_t)s) ? k + 2 : 2;
+        }
+        REQUIRE(statistics.getReductions() == reductions);
+    }
+
+    SECTION("CGLS") {
+        // the images add their part of the transposed product in arbitrary
+        // order, so the history is only compared with the statistics
+        auto rhos = Zee::CGLS::solve(matrix, b, y, maxIterations, tol,
+                                     statistics);
+
+        auto iterations = statistics.getIterations();
+        REQUIRE(iterations + 1 == rhos.size());
+        REQUIRE(calls == iterations);
+        REQUIRE(statistics.getResiduals().back() == rhos.back());
+
+        // a product with A and with its transpose, and two reductions per
+        // iteration
+        REQUIRE(statistics.getSpMVs() == 2 * iterations + 2);
+        REQUIRE(statistics.getReductions() == 2 * iterations + 1);
+    }
+
+    SECTION("block GMRES") {
+        std::vector<Zee::DVector<>> B = {b, ones};
+        std::vector<Zee::DVector<>> Y(2, Zee::DVector<>{n, 0.0});
+        // the images also add their part of the SpMM in arbitrary order
+        auto rhos = Zee::GMRES::solveBlock(matrix, B, Y, (TIdx)20, (TIdx)10,
+                                           tol, statistics);
+
+        // the largest estimate of the active right-hand sides for every
+        // block step
+        auto iterations = statistics.getIterations();
+        REQUIRE(calls == iterations);
+        REQUIRE(rhos[0].size() <= iterations);
+        REQUIRE(rhos[1].size() <= iterations);
+        REQUIRE(statistics.getResiduals()[0] ==
+                std::max(rhos[0][0], rhos[1][0]));
+
+        // three reductions per block step, and for every cycle a residual
+        // norm for each active right-hand side and a TSQR, except for the
+        // last cycle which only finds the converged residuals
+        auto restarts = statistics.getRestarts();
+        REQUIRE(statistics.getReductions() >=
+                3 * iterations + 2 * restarts + 1);
+        REQUIRE(statistics.getReductions() <=
+                3 * iterations + 3 * restarts + 2);
+        REQUIRE(statistics.getSpMVs() >= iterations + restarts + 1);
+        REQUIRE(statistics.getSpMVs() <= 2 * (iterations + restarts + 1));
+    }
+
+    SECTION("GCRO-DR") {
+        Zee::GMRES::RecycledSubspace<> spaceX(3);
+        Zee::GMRES::RecycledSubspace<> spaceY(3);
+        auto rhos = Zee::GMRES::solveRecycled<TVal, TIdx>(matrix, b, x, spaceX,
+                                                          20, 10, tol);
+        auto recorded =
+            Zee::GMRES::solveRecycled(matrix, b, y, spaceY, (TIdx)20,
+                                      (TIdx)10, tol, statistics);
+        REQUIRE(recorded == rhos);
+        REQUIRE(statistics.getResiduals() == rhos);
+        REQUIRE(calls == rhos.size());
+
+        // three reductions per Arnoldi step, and the initial residual norm
+        auto iterations = statistics.getIterations();
+        REQUIRE(statistics.getReductions() >= 3 * iterations + 1);
+        REQUIRE(statistics.getSpMVs() > iterations);
+    }
+
+    REQUIRE(statistics.getSeconds(Zee::solver_phase::spmv) > 0);
+    REQUIRE(statistics.getTotalSeconds() > 0);
+}
+
+TEST_CASE("Chebyshev preconditioning and smoothing", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using TVal = Zee::default_scalar_type;
+
+    auto matrix = Zee::poisson<TIdx>(30, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto b = Zee::DVector<>{n, 0.0};
+
+    Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+        vector_partitioner(matrix, ones, b);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    b = matrix * ones;
+    TVal tol = 1e-5 * b.norm();
+
+    SECTION("the spectrum is bounded from a few Lanczos steps") {
+        // the eigenvalues of the Jacobi-scaled Laplacian lie in (0, 2)
+        Zee::ChebyshevPreconditioner<TVal, TIdx> chebyshev(matrix, 4);
+        auto bounds = chebyshev.getBounds();
+        REQUIRE(bounds.first > 0);
+        REQUIRE(bounds.first < 0.1);
+        REQUIRE(bounds.second > 1.95);
+        REQUIRE(bounds.second < 2.2);
+    }
+
+    SECTION("we can precondition CG and GMRES") {
+        Zee::JacobiPreconditioner<TVal, TIdx> jacobi(matrix);
+        Zee::ChebyshevPreconditioner<TVal, TIdx> chebyshev(matrix, 4);
+
+        auto x = Zee::DVector<>{n, 0.0};
+        auto rhos = Zee::CG::solve(matrix, b, x, jacobi, (TIdx)500, tol);
+
+        auto y = Zee::DVector<>{n, 0.0};
+        auto chebyshevRhos =
+            Zee::CG::solve(matrix, b, y, chebyshev, (TIdx)500, tol);
+        REQUIRE(2 * chebyshevRhos.size() < rhos.size());
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = b - matrix * y;
+        REQUIRE(r.norm() < tol);
+
+        auto z = Zee::DVector<>{n, 0.0};
+        Zee::GMRES::solve(matrix, b, z, chebyshev, (TIdx)10, (TIdx)30, tol);
+        r = b - matrix * z;
+        REQUIRE(r.norm() < 2 * tol);
+    }
+
+    SECTION("we can smooth oscillatory errors") {
+        Zee::ChebyshevPreconditioner<TVal, TIdx> smoother(matrix, 3, 30);
+
+        auto zero = Zee::DVector<>{n, 0.0};
+        auto x = Zee::DVector<>{n, 0.0};
+        for (TIdx i = 0; i < n; ++i) {
+            x[i] = (i % 2 == 0) ? 1 : -1;
+        }
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = matrix * x;
+        auto before = r.norm();
+        smoother.smooth(zero, x);
+        r = matrix * x;
+        REQUIRE(3 * r.norm() < before);
+    }
+}
+
+TEST_CASE("algebraic multigrid preconditioning", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using TVal = Zee::default_scalar_type;
+
+    // the number of AMG-preconditioned CG iterations for the Laplacian on a
+    // k x k grid, and the number of Jacobi-preconditioned CG iterations
+    auto iterations = [](TIdx k) {
+        auto matrix = Zee::poisson<TIdx>(k, 4, Zee::partitioning_scheme::block);
+
+        auto n = matrix.getCols();
+
+        auto ones = Zee::DVector<>{n, 1.0};
+        auto b = Zee::DVector<>{n, 0.0};
+
+        Zee::GreedyVectorPartitioner<decltype(matrix), decltype(b)>
+            vector_partitioner(matrix, ones, b);
+        vector_partitioner.partition();
+        vector_partitioner.localizeMatrix();
+
+        b = matrix * ones;
+        TVal tol = 1e-5 * b.norm();
+
+        Zee::AMGPreconditioner<TVal, TIdx> amg(matrix);
+        REQUIRE(amg.getLevels() > 1);
+        REQUIRE(amg.getImages(0) == 4);
+        for (TIdx level = 1; level < amg.getLevels(); ++level) {
+            REQUIRE(2 * amg.getRows(level) < amg.getRows(level - 1));
+            REQUIRE(amg.getImages(level) <= amg.getImages(level - 1));
+        }
+        REQUIRE(amg.getImages(amg.getLevels() - 1) == 1);
+        REQUIRE(amg.getOperatorComplexity() < 2);
+
+        auto x = Zee::DVector<>{n, 0.0};
+        auto rhos = Zee::CG::solve(matrix, b, x, amg, (TIdx)200, tol);
+
+        auto r = Zee::DVector<>{n, 0.0};
+        r = b - matrix * x;
+        REQUIRE(r.norm() < tol);
+
+        Zee::JacobiPreconditioner<TVal, TIdx> jacobi(matrix);
+        auto y = Zee::DVector<>{n, 0.0};
+        auto jacobiRhos = Zee::CG::solve(matrix, b, y, jacobi, (TIdx)500, tol);
+
+        return std::make_pair(rhos.size(), jacobiRhos.size());
+    };
+
+    auto coarse = iterations(32);
+    auto fine = iterations(64);
+
+    REQUIRE(4 * coarse.first < coarse.second);
+    REQUIRE(4 * fine.first < fine.second);
+
+    // unlike for Jacobi, the number of iterations hardly depends on the size
+    // of the grid
+    REQUIRE(fine.first <= coarse.first + 2);
+}
+
+TEST_CASE("Lanczos and Arnoldi eigensolvers", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using TVal = Zee::default_scalar_type;
+
+    // the eigenvalues of the five-point stencil with off-diagonal elements
+    // -1 -/+ c / 2, on a k x k grid
+    TIdx k = 20;
+    auto exact = [k](double c) {
+        std::vector<double> values;
+        auto pi = std::acos(-1.0);
+        for (TIdx i = 1; i <= k; ++i) {
+            for (TIdx j = 1; j <= k; ++j) {
+                values.push_back(4 - 2 * std::sqrt(1 - c * c / 4) *
+                                         (std::cos(i * pi / (k + 1)) +
+                                          std::cos(j * pi / (k + 1))));
+            }
+        }
+        std::sort(values.begin(), values.end());
+        return values;
+    };
+    auto isEigenvalue = [](const std::vector<double>& values, double theta) {
+        for (auto value : values) {
+            if (std::abs(value - theta) < 1e-3) return true;
+        }
+        return false;
+    };
+
+    auto localize = [](Zee::DSparseMatrix<TVal, TIdx>& matrix) {
+        auto n = matrix.getCols();
+        auto v = Zee::DVector<>{n, 1.0};
+        auto u = Zee::DVector<>{n, 0.0};
+        Zee::GreedyVectorPartitioner<Zee::DSparseMatrix<TVal, TIdx>,
+                                     Zee::DVector<>>
+            vector_partitioner(matrix, v, u);
+        vector_partitioner.partition();
+        vector_partitioner.localizeMatrix();
+    };
+
+    SECTION("Lanczos finds both ends of a symmetric spectrum") {
+        auto matrix = Zee::poisson<TIdx>(k, 4, Zee::partitioning_scheme::block);
+        localize(matrix);
+        auto values = exact(0);
+
+        auto largest = Zee::Lanczos::solve(
+            matrix, (TIdx)4, Zee::eigen_target::largest, (TIdx)30, (TIdx)50,
+            1e-4);
+        REQUIRE(largest.converged);
+        REQUIRE(largest.values.size() == 4);
+        REQUIRE(std::abs(largest.values[0] - values.back()) < 1e-4);
+
+        auto smallest = Zee::Lanczos::solve(
+            matrix, (TIdx)4, Zee::eigen_target::smallest, (TIdx)30, (TIdx)50,
+            1e-4);
+        REQUIRE(smallest.converged);
+        REQUIRE(std::abs(smallest.values[0] - values.front()) < 1e-4);
+
+        for (auto* pairs : {&largest, &smallest}) {
+            for (std::size_t l = 0; l < pairs->values.size(); ++l) {
+                auto theta = pairs->values[l];
+                REQUIRE(isEigenvalue(values, theta));
+
+                auto& x = pairs->vectors[l];
+                auto r = Zee::DVector<>{x.size(), 0.0};
+                r = matrix * x;
+                Zee::axpby((TVal)-theta, x, (TVal)1, r);
+                REQUIRE(std::abs(x.norm() - 1) < 1e-4);
+                REQUIRE(r.norm() < 1e-3);
+            }
+        }
+    }
+
+    SECTION("Arnoldi finds eigenvalues of a nonsymmetric matrix") {
+        auto matrix = Zee::convectionDiffusion<TIdx>(
+            k, 0.2, 4, Zee::partitioning_scheme::block);
+        localize(matrix);
+        auto values = exact(0.2);
+
+        auto smallest = Zee::Arnoldi::solve(
+            matrix, (TIdx)4, Zee::eigen_target::smallest, (TIdx)30, (TIdx)50,
+            1e-4);
+        REQUIRE(smallest.converged);
+        REQUIRE(std::abs(smallest.values[0] - values.front()) < 1e-4);
+        for (std::size_t l = 0; l < smallest.values.size(); ++l) {
+            REQUIRE(std::abs(smallest.values[l].imag()) < 1e-4);
+            REQUIRE(isEigenvalue(values, smallest.values[l].real()));
+            REQUIRE(smallest.residuals[l] < 1e-3);
+        }
+    }
+
+    SECTION("Arnoldi keeps complex conjugate pairs together") {
+        // strong convection gives complex eigenvalues
+        auto matrix = Zee::convectionDiffusion<TIdx>(
+            k, 5, 4, Zee::partitioning_scheme::block);
+        localize(matrix);
+
+        auto pairs = Zee::Arnoldi::solve(
+            matrix, (TIdx)3, Zee::eigen_target::largest_magnitude, (TIdx)30,
+            (TIdx)50, 1e-4);
+        REQUIRE(pairs.converged);
+        REQUIRE(pairs.values.size() == 4);
+
+        // (A - theta I)(x + i y) = 0 for theta = a + i b, i.e.
+        // A x = a x - b y, and A y = b x + a y
+        for (std::size_t l = 0; l < 4; l += 2) {
+            auto theta = pairs.values[l];
+            REQUIRE(theta.imag() > 0);
+            REQUIRE(pairs.values[l + 1] == std::conj(theta));
+
+            auto& x = pairs.vectors[l];
+            auto& y = pairs.vectors[l + 1];
+            auto r = Zee::DVector<>{x.size(), 0.0};
+            r = matrix * x;
+            Zee::axpby((TVal)-theta.real(), x, (TVal)1, r);
+            Zee::axpby((TVal)theta.imag(), y, (TVal)1, r);
+            REQUIRE(r.norm() < 1e-2);
+        }
+    }
+}
+
+TEST_CASE("PageRank of a partitioned graph", "[solvers]") {
+    using TIdx = Zee::default_index_type;
+    using TVal = Zee::default_scalar_type;
+
+    // a graph with mostly local links, and dangling nodes
+    TIdx n = 1000;
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<TIdx> node(0, n - 1);
+    std::vector<Zee::Triplet<TVal, TIdx>> links;
+    for (TIdx i = 0; i < n; ++i) {
+        if (i % 10 == 3) continue;
+        for (int l = 0; l < 5; ++l) {
+            TIdx j = (l < 4) ? (i + 1 + node(generator) % 20) % n
+                             : node(generator);
+            links.push_back(Zee::Triplet<TVal, TIdx>(i, j, 1));
+        }
+    }
+
+    Zee::DSparseMatrix<TVal, TIdx> A(n, n);
+    A.setDistributionScheme(Zee::partitioning_scheme::block, 4);
+    A.setFromTriplets(links.begin(), links.end());
+
+    auto v = Zee::DVector<>{n, 1.0};
+    auto u = Zee::DVector<>{n, 0.0};
+    Zee::GreedyVectorPartitioner<decltype(A), decltype(u)> vector_partitioner(
+        A, v, u);
+    vector_partitioner.partition();
+    vector_partitioner.localizeMatrix();
+
+    // the reference, by the power method with dense dangling links
+    double damping = 0.85;
+    std::vector<double> degree(n, 0);
+    for (auto& link : links) {
+        degree[link.row()] += 1;
+    }
+    std::vector<double> reference(n, 1.0 / n);
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        std::vector<double> next(n, 0);
+        for (TIdx i = 0; i < n; ++i) {
+            for (TIdx j = 0; j < n && degree[i] == 0; ++j) {
+                next[j] += damping * reference[i] / n;
+            }
+        }
+        for (auto& link : links) {
+            next[link.col()] +=
+                damping * reference[link.row()] / degree[link.row()];
+        }
+        for (auto& rank : next) {
+            rank += (1 - damping) / n;
+        }
+        reference = next;
+    }
+
+    auto x = Zee::DVector<>{n, 0.0};
+    auto changes = Zee::PageRank::solve(A, x, (TVal)damping, (TIdx)100,
+                                        (TVal)1e-6);
+    REQUIRE(changes.back() < 1e-6);
+
+    auto y = Zee::DVector<>{n, 0.0};
+    auto sweeps = Zee::PageRank::solve(A, y, (TVal)damping, (TIdx)100,
+                                       (TVal)1e-6,
+                                       Zee::pagerank_method::gauss_seidel);
+    REQUIRE(sweeps.back() < 1e-6);
+    REQUIRE(2 * sweeps.size() < changes.size());
+
+    double error = 0;
+    double errorSweeps = 0;
+    double total = 0;
+    for (TIdx i = 0; i < n; ++i) {
+        error += std::abs(x[i] - reference[i]);
+        errorSweeps += std::abs(y[i] - reference[i]);
+        total += x[i];
+    }
+    REQUIRE(error < 1e-4);
+    REQUIRE(errorSweeps < 1e-4);
+    REQUIRE(std::abs(total - 1) < 1e-4);
+}
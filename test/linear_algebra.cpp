@@ -55,6 +55,36 @@ TEST_CASE("vector operations", "[linear algebra]") {
     }
 }
 
+TEST_CASE("vector reductions", "[linear algebra]") {
+    SECTION("we can compute dot products and norms") {
+        REQUIRE(x.dot(y) == 4.0f);
+        REQUIRE(x.norm() == 2.0f);
+    }
+
+    SECTION("reductions are accurate for long vectors") {
+        TIdx n = 1 << 20;
+        Zee::DVector<TVal, TIdx> v{n, 0.1f};
+        REQUIRE(std::abs(v.dot(v) - 0.01 * n) < 1e-5 * 0.01 * n);
+    }
+
+    SECTION("reductions do not depend on the number of threads") {
+        TIdx n = 100000;
+        Zee::DVector<TVal, TIdx> v{n};
+        for (TIdx i = 0; i < n; ++i) {
+            v[i] = 1.0f / (1 + (i * 7919) % 1013);
+        }
+
+        auto threads = Zee::kernelThreads();
+        Zee::setKernelThreads(1);
+        auto serial = v.dot(v);
+        Zee::setKernelThreads(7);
+        auto parallel = v.dot(v);
+        Zee::setKernelThreads(threads);
+
+        REQUIRE(serial == parallel);
+    }
+}
+
 Zee::DSparseMatrix<TVal, TIdx> A{"test/mtx/sparse_example.mtx", 1};
 Zee::DSparseMatrix<TVal, TIdx> S{"test/mtx/square_sparse_example.mtx", 1};
 
@@ -104,3 +134,481 @@ TEST_CASE("matrix operations", "[linear algebra]") {
         }
     }
 }
+
+TEST_CASE("fused sparse kernels", "[linear algebra]") {
+    auto P = Zee::poisson<TIdx>(20, 3);
+    auto n = P.getRows();
+
+    Zee::DVector<TVal, TIdx> v(n);
+    Zee::DVector<TVal, TIdx> u(n);
+    for (TIdx i = 0; i < n; ++i) {
+        v[i] = (TVal)(i % 7) - 3;
+    }
+
+    Zee::GreedyVectorPartitioner<decltype(P), decltype(v)> partitioner(P, v,
+                                                                       u);
+    partitioner.partition();
+    partitioner.localizeMatrix();
+
+    SECTION("we can compute an spmv together with a dot product") {
+        auto product = Zee::multiplyDot(P, v, u);
+
+        Zee::DVector<TVal, TIdx> w(n);
+        w = P * v;
+        REQUIRE(u == w);
+        REQUIRE(std::abs(product - v.dot(w)) <= 1e-5 * std::abs(product));
+
+        // the partial sums of a repeated product reuse pooled buffers
+        auto& pool = Zee::VectorPool<TVal>::global();
+        auto hits = pool.hits();
+        auto misses = pool.misses();
+        REQUIRE(Zee::multiplyDot(P, v, u) == product);
+        REQUIRE(pool.hits() >= hits + P.getProcs());
+        REQUIRE(pool.misses() == misses);
+    }
+
+    SECTION("we can compute an spmv together with its norm") {
+        auto norm = Zee::multiplyNorm(P, v, u);
+
+        Zee::DVector<TVal, TIdx> w(n);
+        w = P * v;
+        REQUIRE(u == w);
+        REQUIRE(std::abs(norm - w.norm()) <= 1e-5 * norm);
+
+        // the components are summed in image order by their owners, so the
+        // result is reproducible, also when the output aliases v
+        REQUIRE(Zee::multiplyNorm(P, v, u) == norm);
+        Zee::copy(v, w);
+        REQUIRE(Zee::multiplyNorm(P, w, w) == norm);
+        REQUIRE(w == u);
+    }
+
+    SECTION("we can compute a residual together with its norm") {
+        Zee::DVector<TVal, TIdx> b(n);
+        for (TIdx i = 0; i < n; ++i) {
+            b[i] = (TVal)(i % 5);
+        }
+
+        auto norm = Zee::residual(P, v, b, u);
+
+        Zee::DVector<TVal, TIdx> r(n);
+        r = b - P * v;
+        for (TIdx i = 0; i < n; ++i) {
+            REQUIRE(std::abs(u[i] - r[i]) <= 1e-5);
+        }
+        REQUIRE(std::abs(norm - r.norm()) <= 1e-5 * norm);
+
+        // the output may alias the right-hand side
+        Zee::residual(P, v, b, b);
+        for (TIdx i = 0; i < n; ++i) {
+            REQUIRE(std::abs(b[i] - r[i]) <= 1e-5);
+        }
+    }
+}
+
+TEST_CASE("matrix powers kernel", "[linear algebra]") {
+    auto P = Zee::convectionDiffusion<TIdx>(20, 0.5, 4,
+                                            Zee::partitioning_scheme::block);
+    auto n = P.getRows();
+    TIdx s = 3;
+
+    Zee::DVector<TVal, TIdx> v(n);
+    Zee::DVector<TVal, TIdx> u(n);
+    for (TIdx i = 0; i < n; ++i) {
+        v[i] = (TVal)(i % 7) - 3;
+    }
+
+    Zee::GreedyVectorPartitioner<decltype(P), decltype(v)> partitioner(P, v,
+                                                                       u);
+    partitioner.partition();
+    partitioner.localizeMatrix();
+
+    Zee::MatrixPowers<TVal, TIdx> powers(P, s);
+
+    SECTION("the first layer holds the ghost elements of an spmv") {
+        for (TIdx p = 0; p < P.getProcs(); ++p) {
+            auto& image = P.getImages()[p];
+            REQUIRE(powers.getLayerEnd(p, 0) == image->getNumLocalV());
+            REQUIRE(powers.getLayerEnd(p, 1) ==
+                    image->getLocalIndicesV().size());
+            REQUIRE(powers.getDomainSize(p) == powers.getLayerEnd(p, s));
+            REQUIRE(powers.getDomainSize(p) < n);
+        }
+    }
+
+    SECTION("the powers agree with repeated spmvs") {
+        std::vector<Zee::DVector<TVal, TIdx>> V(s + 1,
+                                                Zee::DVector<TVal, TIdx>(n));
+        powers.apply(v, V, 1);
+
+        Zee::DVector<TVal, TIdx> w = v;
+        for (TIdx k = 1; k <= s; ++k) {
+            u = P * w;
+            Zee::copy(u, w);
+            for (TIdx i = 0; i < n; ++i) {
+                REQUIRE(std::abs(V[k][i] - w[i]) <=
+                        1e-5 * (1 + std::abs(w[i])));
+            }
+        }
+        REQUIRE(V[0].norm() == 0);
+    }
+}
+
+TEST_CASE("block sparse kernels", "[linear algebra]") {
+    auto P = Zee::convectionDiffusion<TIdx>(20, 0.5, 3);
+    auto n = P.getRows();
+    TIdx k = 4;
+
+    std::vector<Zee::DVector<TVal, TIdx>> V(k, Zee::DVector<TVal, TIdx>(n));
+    for (TIdx i = 0; i < n; ++i) {
+        for (TIdx c = 0; c < k; ++c) {
+            V[c][i] = (TVal)((i + 3 * c) % 7) - 3;
+        }
+    }
+
+    Zee::DVector<TVal, TIdx> u(n);
+    Zee::GreedyVectorPartitioner<decltype(P), decltype(u)> partitioner(
+        P, V[0], u);
+    partitioner.partition();
+    partitioner.localizeMatrix();
+
+    SECTION("an spmm agrees with separate spmvs") {
+        std::vector<Zee::DVector<TVal, TIdx>> U(k,
+                                                Zee::DVector<TVal, TIdx>(n));
+        Zee::multiplyBlock(P, V, U);
+        for (TIdx c = 0; c < k; ++c) {
+            u = P * V[c];
+            for (TIdx i = 0; i < n; ++i) {
+                REQUIRE(std::abs(U[c][i] - u[i]) <= 1e-5 * (1 + std::abs(u[i])));
+            }
+        }
+    }
+
+    SECTION("tsqr computes an orthonormal basis of the block") {
+        auto Q = V;
+        auto R = Zee::tsqr(Q);
+
+        for (TIdx c = 0; c < k; ++c) {
+            REQUIRE(R[c * k + c] >= 0);
+            for (TIdx l = 0; l < k; ++l) {
+                auto expected = (c == l) ? 1.0f : 0.0f;
+                REQUIRE(std::abs(Q[c].dot(Q[l]) - expected) < 1e-5);
+            }
+
+            // V = Q R
+            for (TIdx i = 0; i < n; ++i) {
+                TVal sum = 0;
+                for (TIdx l = 0; l <= c; ++l) {
+                    sum += Q[l][i] * R[c * k + l];
+                }
+                REQUIRE(std::abs(sum - V[c][i]) < 1e-4);
+            }
+        }
+    }
+
+    SECTION("tsqr combines the factors of blocks of rows") {
+        TIdx m = 3 * Zee::detail::tsqr_chunk_rows + 17;
+        std::vector<Zee::DVector<TVal, TIdx>> W(k,
+                                                Zee::DVector<TVal, TIdx>(m));
+        for (TIdx i = 0; i < m; ++i) {
+            for (TIdx c = 0; c < k; ++c) {
+                W[c][i] = 1.0f / (1 + (i * (c + 1)) % 13);
+            }
+        }
+
+        auto Q = W;
+        auto R = Zee::tsqr(Q);
+        for (TIdx c = 0; c < k; ++c) {
+            REQUIRE(std::abs(Q[c].norm() - 1) < 1e-5);
+            REQUIRE(std::abs(R[c * k + c] - Q[c].dot(W[c])) <
+                    1e-4 * R[c * k + c]);
+            for (TIdx l = 0; l < c; ++l) {
+                REQUIRE(std::abs(Q[c].dot(Q[l])) < 1e-5);
+            }
+        }
+    }
+}
+
+TEST_CASE("block vector kernels", "[linear algebra]") {
+    TIdx n = 10000;
+    TIdx k = 5;
+    std::vector<Zee::DVector<TVal, TIdx>> V(k, Zee::DVector<TVal, TIdx>{n});
+    Zee::DVector<TVal, TIdx> w{n};
+    for (TIdx i = 0; i < n; ++i) {
+        w[i] = 1.0f / (1 + i % 17);
+        for (TIdx j = 0; j < k; ++j) {
+            V[j][i] = (TVal)((i + j) % 5) - 2.0f;
+        }
+    }
+
+    SECTION("multi-dot agrees with separate dot products") {
+        Zee::DVector<TVal, TIdx> h{k + 1};
+        Zee::multiDot(V, k, w, h);
+        for (TIdx j = 0; j < k; ++j) {
+            REQUIRE(h[j] == V[j].dot(w));
+        }
+        REQUIRE(h[k] == 0.0f);
+    }
+
+    SECTION("multi-axpy agrees with separate updates") {
+        Zee::DVector<TVal, TIdx> h{k};
+        for (TIdx j = 0; j < k; ++j) {
+            h[j] = 0.5f * j;
+        }
+
+        auto expected = Zee::DVector<TVal, TIdx>(w);
+        for (TIdx j = 0; j < k; ++j) {
+            expected -= V[j] * h[j];
+        }
+
+        Zee::multiAxpy(-1.0f, V, k, h, w);
+        REQUIRE(w == expected);
+    }
+
+    SECTION("block kernels agree with the kernels for every column") {
+        std::size_t b = 3;
+        std::vector<Zee::DVector<TVal, TIdx>> W;
+        std::vector<TVal*> block;
+        for (std::size_t c = 0; c < b; ++c) {
+            W.push_back(Zee::DVector<TVal, TIdx>(w));
+            Zee::scale((TVal)(c + 1), W[c]);
+            W[c][c] = 3.0f;
+        }
+        for (auto& u : W) {
+            block.push_back(u.data());
+        }
+        auto columns = Zee::detail::columnPointers(V, k);
+
+        std::vector<TVal> H(k * b);
+        Zee::detail::blockDot<TVal>(n, columns.data(), k, block.data(), b,
+                                    H.data());
+        std::vector<TVal> h(k);
+        for (std::size_t c = 0; c < b; ++c) {
+            Zee::detail::multiDot<TVal>(n, columns.data(), k, W[c].data(),
+                                        h.data());
+            for (TIdx j = 0; j < k; ++j) {
+                REQUIRE(H[c * k + j] == h[j]);
+            }
+        }
+
+        std::vector<Zee::DVector<TVal, TIdx>> expected;
+        for (std::size_t c = 0; c < b; ++c) {
+            expected.push_back(Zee::DVector<TVal, TIdx>(W[c]));
+            Zee::detail::multiAxpy<TVal>(n, -1.0f, columns.data(), k,
+                                         H.data() + c * k,
+                                         expected[c].data());
+        }
+        Zee::detail::blockAxpy<TVal>(n, -1.0f, columns.data(), k, H.data(),
+                                     block.data(), b);
+        for (std::size_t c = 0; c < b; ++c) {
+            REQUIRE(W[c] == expected[c]);
+        }
+    }
+}
+
+TEST_CASE("vector kernels", "[linear algebra]") {
+    TIdx n = 100000;
+    Zee::DVector<TVal, TIdx> v{n, 2.0f};
+    Zee::DVector<TVal, TIdx> w{n, 1.0f};
+
+    SECTION("we can scale and combine vectors in place") {
+        auto bytes = Zee::axpby(2.0f, v, 3.0f, w);
+        REQUIRE(w[n - 1] == 7.0f);
+        REQUIRE(bytes == 3 * sizeof(TVal) * n);
+
+        Zee::scale(0.5f, w);
+        REQUIRE(w[0] == 3.5f);
+
+        Zee::waxpby(1.0f, v, -1.0f, w, w);
+        REQUIRE(w[n / 2] == -1.5f);
+
+        Zee::copy(v, w);
+        REQUIRE(w == v);
+    }
+
+    SECTION("linear combinations are fused") {
+        Zee::DVector<TVal, TIdx> u{n};
+        u = v + 2.0f * w;
+        REQUIRE(u[0] == 4.0f);
+        u = v - 2.0f * w;
+        REQUIRE(u[0] == 0.0f);
+        u = 3.0f * v + w;
+        REQUIRE(u[0] == 7.0f);
+        u = 3.0f * v + w * 0.5f;
+        REQUIRE(u[0] == 6.5f);
+        u -= v * 2.0f;
+        REQUIRE(u[0] == 2.5f);
+        u += 0.5f * w;
+        REQUIRE(u[0] == 3.0f);
+    }
+}
+
+TEST_CASE("vector pool", "[linear algebra]") {
+    auto& pool = Zee::VectorPool<TVal>::global();
+
+    SECTION("vectors of the same size reuse storage") {
+        { Zee::DVector<TVal, TIdx> v{1234}; }
+        auto misses = pool.misses();
+        {
+            Zee::DVector<TVal, TIdx> v{1234, 1.0f};
+            REQUIRE(v[1233] == 1.0f);
+        }
+        REQUIRE(pool.misses() == misses);
+    }
+
+    SECTION("expressions reuse storage") {
+        Zee::DVector<TVal, TIdx> v{1234, 1.0f};
+        Zee::DVector<TVal, TIdx> w{1234};
+        w = 2.0f * v + v;
+        auto misses = pool.misses();
+        for (int k = 0; k < 10; ++k) {
+            w = 2.0f * v + w;
+        }
+        REQUIRE(pool.misses() == misses);
+        REQUIRE(w[0] == 23.0f);
+    }
+}
+
+TEST_CASE("partitioned vectors", "[linear algebra]") {
+    TIdx procs = 3;
+    Zee::DSparseMatrix<TVal, TIdx> M{"test/mtx/ex24.mtx", 1};
+    Zee::CyclicPartitioner<decltype(M)> cyclic(procs, Zee::CyclicType::column);
+    cyclic.partition(M);
+
+    auto n = M.getCols();
+    Zee::DVector<TVal, TIdx> v{n, 1.0};
+    Zee::DVector<TVal, TIdx> u{n};
+    for (TIdx i = 0; i < n; ++i) {
+        v[i] = 1.0f + (i % 7);
+    }
+
+    Zee::GreedyVectorPartitioner<decltype(M), decltype(v)> part_vector(M, v,
+                                                                       u);
+    part_vector.partition();
+    part_vector.localizeMatrix();
+
+    Zee::DPartitionedVector<TVal, TIdx> pv(M, Zee::vector_space::column);
+    pv.scatter(v);
+
+    SECTION("images only store their own and ghost elements") {
+        TIdx stored = 0;
+        for (auto& image : pv.getImages()) {
+            REQUIRE(image->size() < n);
+            stored += image->getNumLocal();
+        }
+        REQUIRE(stored == n);
+        REQUIRE(pv.at(5) == v[5]);
+    }
+
+    SECTION("we can perform a distributed spmv") {
+        u = M * v;
+        Zee::DPartitionedVector<TVal, TIdx> pu(M, Zee::vector_space::row);
+        pu = M * pv;
+
+        auto gathered = pu.gather();
+        for (TIdx i = 0; i < n; ++i) {
+            REQUIRE(std::abs(gathered[i] - u[i]) <= 1e-4 * std::abs(u[i]));
+        }
+
+        // without the copy of the expression, the ghosts of pv are updated
+        Zee::DPartitionedVector<TVal, TIdx> pw(M, Zee::vector_space::row);
+        Zee::multiply(M, pv, pw);
+        for (TIdx i = 0; i < n; ++i) {
+            REQUIRE(pw.at(i) == pu.at(i));
+        }
+    }
+
+    SECTION("we can perform vector operations") {
+        auto w = Zee::DPartitionedVector<TVal, TIdx>(pv);
+        w = 2.0f * (pv + pv) - pv;
+        REQUIRE(w.at(3) == 3.0f * v[3]);
+        REQUIRE(std::abs(pv.dot(pv) - v.dot(v)) < 1e-5 * v.dot(v));
+    }
+}
+
+TEST_CASE("dense eigenvalue problems", "[linear algebra]") {
+    // eigenvalues 3, -1 and 1 +- 2i, stored by columns
+    std::size_t n = 4;
+    std::vector<double> a = {3, 0, 0, 0, 1, -1, 0, 0,
+                             0, 1, 1, 2, 2, 1, -2, 1};
+    // permute the rows and columns so that the matrix is not triangular
+    std::vector<double> b(n * n);
+    std::vector<std::size_t> order = {2, 0, 3, 1};
+    for (std::size_t j = 0; j < n; ++j) {
+        for (std::size_t i = 0; i < n; ++i) {
+            b[j * n + i] = a[order[j] * n + order[i]];
+        }
+    }
+
+    SECTION("we can solve dense systems") {
+        std::vector<double> solution = {1, 2, 3, 4};
+        std::vector<double> rhs(n, 0);
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t i = 0; i < n; ++i) {
+                rhs[i] += b[j * n + i] * solution[j];
+            }
+        }
+        auto result = Zee::detail::solveDense(n, b, rhs);
+        for (std::size_t i = 0; i < n; ++i) {
+            REQUIRE(std::abs(result[i] - solution[i]) < 1e-12);
+        }
+    }
+
+    SECTION("we can find eigenvalues and eigenvectors") {
+        auto theta = Zee::detail::eigenvalues(n, b);
+        REQUIRE(theta.size() == n);
+
+        std::vector<std::complex<double>> expected = {
+            {3, 0}, {-1, 0}, {1, 2}, {1, -2}};
+        for (auto value : expected) {
+            auto found = false;
+            for (auto t : theta) {
+                if (std::abs(t - value) < 1e-10) found = true;
+            }
+            REQUIRE(found);
+        }
+
+        for (auto t : theta) {
+            auto v = Zee::detail::eigenvector(n, b, t);
+            double defect = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::complex<double> sum = -t * v[i];
+                for (std::size_t j = 0; j < n; ++j) {
+                    sum += b[j * n + i] * v[j];
+                }
+                defect = std::hypot(defect, std::abs(sum));
+            }
+            REQUIRE(defect < 1e-10);
+        }
+    }
+
+    SECTION("we can diagonalize symmetric matrices") {
+        // the symmetric part of b
+        std::vector<double> s(n * n);
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t i = 0; i < n; ++i) {
+                s[j * n + i] = (b[j * n + i] + b[i * n + j]) / 2;
+            }
+        }
+
+        auto eigen = Zee::detail::symmetricEigen(n, s);
+        auto& theta = eigen.first;
+        auto& V = eigen.second;
+        for (std::size_t l = 0; l < n; ++l) {
+            for (std::size_t i = 0; i < n; ++i) {
+                double sum = -theta[l] * V[l * n + i];
+                for (std::size_t j = 0; j < n; ++j) {
+                    sum += s[j * n + i] * V[l * n + j];
+                }
+                REQUIRE(std::abs(sum) < 1e-12);
+            }
+            for (std::size_t m = 0; m < n; ++m) {
+                double dot = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    dot += V[l * n + i] * V[m * n + i];
+                }
+                REQUIRE(std::abs(dot - ((l == m) ? 1 : 0)) < 1e-12);
+            }
+        }
+    }
+}
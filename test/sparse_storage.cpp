@@ -22,3 +22,43 @@ TEST_CASE("moving non-zeros in storage", "[sparse storage]") {
     REQUIRE(matrix[0].nonZeros() == 2);
     REQUIRE(matrix[1].nonZeros() == 3);
 }
+
+TEST_CASE("updating the values of non-zeros", "[sparse storage]") {
+    auto matrix = Zee::convectionDiffusion<TIdx>(
+        10, 0.5, 4, Zee::partitioning_scheme::block);
+
+    auto n = matrix.getCols();
+    auto ones = Zee::DVector<>{n, 1.0};
+    auto u = Zee::DVector<>{n, 0.0};
+
+    auto scaleDiagonal = [](TIdx i, TIdx j, TVal value) {
+        return (i == j) ? 2 * value : value;
+    };
+
+    SECTION("before localizing") {
+        auto nonZeros = matrix.nonZeros();
+        matrix.updateValues(scaleDiagonal);
+        REQUIRE(matrix.nonZeros() == nonZeros);
+        for (auto& image : matrix.getImages()) {
+            for (const auto& triplet : *image) {
+                if (triplet.row() == triplet.col()) {
+                    REQUIRE(triplet.value() == 8.0f);
+                }
+            }
+        }
+    }
+
+    SECTION("after localizing") {
+        Zee::GreedyVectorPartitioner<decltype(matrix), decltype(u)>
+            vector_partitioner(matrix, ones, u);
+        vector_partitioner.partition();
+        vector_partitioner.localizeMatrix();
+
+        // the row sums of A are zero in the interior, and become 4
+        u = matrix * ones;
+        auto before = u[55];
+        matrix.updateValues(scaleDiagonal);
+        u = matrix * ones;
+        REQUIRE(u[55] == before + 4.0f);
+    }
+}